@@ -0,0 +1,280 @@
+#include "analysis.h"
+#include "movegen.h"
+#include "session.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+bool isNumber(const std::string &s) {
+    return !s.empty() && s.size() <= 19 && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+void appendMoves(std::string &json, const Move *begin, const Move *end) {
+    json += '[';
+    for (const Move *m = begin; m != end; ++m) {
+        if (m != begin) json += ',';
+        json += '"' + moveToString(*m) + '"';
+    }
+    json += ']';
+}
+
+}
+
+const char *analysisOpName(AnalysisOp op) {
+    switch (op) {
+        case ANALYSIS_LEGAL: return "legal";
+        case ANALYSIS_STATUS: return "status";
+        case ANALYSIS_BESTMOVE: return "bestmove";
+        default: return "stats";
+    }
+}
+
+bool parseAnalysisRequest(const std::string &line, AnalysisRequest &out, std::string &error) {
+    std::istringstream in(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (in >> token) tokens.push_back(token);
+    size_t i = 0;
+    if (tokens.empty() || !isNumber(tokens[0])) {
+        error = "expected a request id";
+        return false;
+    }
+    out.id = std::strtoull(tokens[i++].c_str(), NULL, 10);
+    if (i == tokens.size()) {
+        error = "missing request";
+        return false;
+    }
+    const std::string &name = tokens[i++];
+    if (name == "legal") out.op = ANALYSIS_LEGAL;
+    else if (name == "status") out.op = ANALYSIS_STATUS;
+    else if (name == "bestmove") out.op = ANALYSIS_BESTMOVE;
+    else if (name == "stats") out.op = ANALYSIS_STATS;
+    else {
+        error = "unknown request";
+        return false;
+    }
+    if (out.op == ANALYSIS_STATS) return true;
+
+    out.limits = SearchLimits();
+    while (out.op == ANALYSIS_BESTMOVE && i + 1 < tokens.size() && isNumber(tokens[i + 1])) {
+        const std::string &key = tokens[i];
+        int64_t value = std::strtoll(tokens[i + 1].c_str(), NULL, 10);
+        if (key == "depth") out.limits.depth = int(std::min<int64_t>(value, MAX_PLY - 1));
+        else if (key == "nodes") out.limits.nodes = uint64_t(value);
+        else if (key == "movetime") out.limits.movetimeMs = value;
+        else break;
+        i += 2;
+    }
+
+    std::string fen;
+    for (; i < tokens.size() && tokens[i] != "moves"; ++i) fen += (fen.empty() ? "" : " ") + tokens[i];
+    if (fen == "startpos") fen = START_FEN;
+    if (fen.empty() || !loadFen(out.position, fen)) {
+        error = "invalid position";
+        return false;
+    }
+    for (size_t first = ++i; i < tokens.size(); ++i) {
+        Move m;
+        if (!parseMove(out.position, tokens[i], m)) {
+            error = "illegal move " + std::to_string(i - first + 1);    // by number, so the JSON needs no escaping
+            return false;
+        }
+        makeMove(out.position, m);
+    }
+    return true;
+}
+
+void AnalysisPool::LatencyWindow::add(uint32_t us) {
+    if (samples.size() < SIZE) samples.push_back(us);
+    else samples[next] = us;
+    next = (next + 1) % SIZE;
+    ++count;
+}
+
+AnalysisLatency AnalysisPool::LatencyWindow::summary() const {
+    AnalysisLatency s;
+    s.count = count;
+    if (samples.empty()) return s;
+    std::vector<uint32_t> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    s.p50Us = sorted[sorted.size() / 2];
+    s.p99Us = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    return s;
+}
+
+AnalysisPool::AnalysisPool(int workerCount, size_t hashMb, ReplyCallback r) : reply(r) {
+    workerCount = std::max(2, workerCount);
+    maxSearches = workerCount - 1;
+    tt.resize(hashMb);
+    for (int i = 0; i < workerCount; ++i) workers.emplace_back(&AnalysisPool::run, this);
+}
+
+AnalysisPool::~AnalysisPool() {
+    shutdown();
+}
+
+void AnalysisPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (quit) return;
+        quit = true;
+        quick.clear();
+        searches.clear();
+    }
+    stopSearches = true;
+    wake.notify_all();
+    for (std::thread &w : workers)
+        if (w.joinable()) w.join();
+}
+
+void AnalysisPool::submit(uint64_t client, const std::string &line) {
+    Job job;
+    job.client = client;
+    job.received = Clock::now();
+    std::string error;
+    if (!parseAnalysisRequest(line, job.request, error)) {
+        Replies replies;
+        replies.emplace_back(client, "{\"id\":" + std::to_string(job.request.id) + ",\"error\":\"" + error + "\"}");
+        reply(replies);
+        return;
+    }
+    if (job.request.op == ANALYSIS_STATS) {
+        Replies replies;
+        replies.emplace_back(client, statsJson(job.request.id));
+        reply(replies);
+        return;
+    }
+
+    SearchLimits &limits = job.request.limits;
+    if (!limits.depth && !limits.nodes && !limits.movetimeMs) limits.movetimeMs = DEFAULT_MOVETIME_MS;
+    limits.movetimeMs = limits.movetimeMs ? std::min(limits.movetimeMs, MAX_MOVETIME_MS) : MAX_MOVETIME_MS;
+    limits.stop = &stopSearches;
+    limits.threads = 1;
+    limits.newSearch = false;    // run() ages the shared table
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (quit) return;
+        if (job.request.op == ANALYSIS_BESTMOVE) searches.push_back(std::move(job));
+        else quick.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void AnalysisPool::run() {
+    std::vector<Job> batch;
+    Replies replies;
+    for (;;) {
+        bool searching = false;
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] {
+                return quit || !quick.empty() || (!searches.empty() && runningSearches < maxSearches);
+            });
+            if (quit) return;
+            if (!quick.empty()) {
+                // An even share of the backlog, so one worker does not sit on
+                // a long batch while the others are idle.
+                size_t take = std::min<size_t>(QUICK_BATCH, (quick.size() + workers.size() - 1) / workers.size());
+                for (size_t i = 0; i < take; ++i) {
+                    batch.push_back(std::move(quick.front()));
+                    quick.pop_front();
+                }
+                if (!quick.empty()) wake.notify_one();
+            } else {
+                batch.push_back(std::move(searches.front()));
+                searches.pop_front();
+                ++runningSearches;
+                tt.newSearch();
+                searching = true;
+            }
+        }
+        for (Job &job : batch) {
+            replies.emplace_back(job.client, std::string());
+            answer(job, replies.back().second);
+        }
+        if (searching) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --runningSearches;
+            }
+            wake.notify_one();
+        }
+        reply(replies);
+        replies.clear();
+    }
+}
+
+void AnalysisPool::answer(Job &job, std::string &line) {
+    const AnalysisRequest &r = job.request;
+    const GameState &g = r.position;
+    line = "{\"id\":" + std::to_string(r.id);
+    if (r.op == ANALYSIS_LEGAL) {
+        MoveList list;
+        generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+        line += ",\"count\":" + std::to_string(list.count) + ",\"moves\":";
+        appendMoves(line, list.begin(), list.end());
+    } else if (r.op == ANALYSIS_STATUS) {
+        MoveList list;
+        generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+        line += std::string(",\"status\":\"") + gameStatusName(gameStatus(g)) + "\",\"check\":"
+              + (isInCheck(g, g.whiteTurn) ? "true" : "false") + ",\"moves\":" + std::to_string(list.count);
+    } else {
+        SearchResult result = search(g, r.limits, tt);
+        const SearchInfo &info = result.info;
+        if (!result.hasMove) {
+            line += std::string(",\"bestmove\":null,\"status\":\"") + gameStatusName(gameStatus(g)) + "\"";
+        } else {
+            line += ",\"bestmove\":\"" + moveToString(result.best) + "\",\"depth\":" + std::to_string(info.depth);
+            if (isMateScore(info.score)) {
+                int moves = (SCORE_MATE - std::abs(info.score) + 1) / 2;
+                line += ",\"mate\":" + std::to_string(info.score > 0 ? moves : -moves);
+            } else {
+                line += ",\"score\":" + std::to_string(info.score);
+            }
+            line += ",\"nodes\":" + std::to_string(info.nodes) + ",\"pv\":";
+            appendMoves(line, info.pv.data(), info.pv.data() + info.pv.size());
+        }
+    }
+    uint32_t us = uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.received).count());
+    line += ",\"us\":" + std::to_string(us) + "}";
+    std::lock_guard<std::mutex> lock(statsMutex);
+    latency[r.op].add(us);
+    ++served;
+}
+
+AnalysisStats AnalysisPool::stats() const {
+    AnalysisStats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        s.queuedQuick = quick.size();
+        s.queuedSearches = searches.size();
+        s.runningSearches = runningSearches;
+        s.workers = int(workers.size());
+    }
+    std::lock_guard<std::mutex> lock(statsMutex);
+    s.served = served;
+    for (int op = 0; op < ANALYSIS_OPS; ++op) s.latency[op] = latency[op].summary();
+    return s;
+}
+
+std::string AnalysisPool::statsJson(uint64_t id) const {
+    AnalysisStats s = stats();
+    std::string json = "{\"id\":" + std::to_string(id) + ",\"workers\":" + std::to_string(s.workers)
+                     + ",\"queued\":" + std::to_string(s.queuedQuick + s.queuedSearches)
+                     + ",\"queued_searches\":" + std::to_string(s.queuedSearches)
+                     + ",\"running_searches\":" + std::to_string(s.runningSearches)
+                     + ",\"served\":" + std::to_string(s.served);
+    for (int op = 0; op < ANALYSIS_STATS; ++op) {
+        const AnalysisLatency &l = s.latency[op];
+        json += std::string(",\"") + analysisOpName(AnalysisOp(op)) + "\":{\"count\":" + std::to_string(l.count)
+              + ",\"p50_us\":" + std::to_string(uint64_t(l.p50Us)) + ",\"p99_us\":" + std::to_string(uint64_t(l.p99Us))
+              + "}";
+    }
+    return json + "}";
+}
@@ -0,0 +1,124 @@
+#ifndef CHESS_ANALYSIS_H
+#define CHESS_ANALYSIS_H
+
+#include "search.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// One line of the analysis protocol:
+//
+//   <id> legal <FEN | startpos> [moves m1 m2 ...]
+//   <id> status <FEN | startpos> [moves ...]
+//   <id> bestmove [depth N] [nodes N] [movetime MS] <FEN | startpos> [moves ...]
+//   <id> stats
+//
+// Every request is answered by one line of JSON carrying the same id, as
+// {"id":7,...} or {"id":7,"error":"..."}. Answers come back in completion
+// order, which need not be the order the requests were sent in.
+enum AnalysisOp { ANALYSIS_LEGAL, ANALYSIS_STATUS, ANALYSIS_BESTMOVE, ANALYSIS_STATS, ANALYSIS_OPS };
+
+struct AnalysisRequest {
+    uint64_t id = 0;
+    AnalysisOp op = ANALYSIS_LEGAL;
+    GameState position;
+    SearchLimits limits;
+};
+
+// False with error set when the line is not a valid request; id is still
+// filled in if the line started with one.
+bool parseAnalysisRequest(const std::string &line, AnalysisRequest &out, std::string &error);
+const char *analysisOpName(AnalysisOp op);
+
+struct AnalysisLatency {
+    uint64_t count = 0;
+    double p50Us = 0, p99Us = 0;
+};
+
+struct AnalysisStats {
+    size_t queuedQuick = 0, queuedSearches = 0;
+    int runningSearches = 0;
+    int workers = 0;
+    uint64_t served = 0;
+    AnalysisLatency latency[ANALYSIS_OPS];    // receipt to answer, over the recent window
+};
+
+// Answers requests on a pool of worker threads sharing one transposition
+// table, which stays warm from one request to the next and ages once per
+// search request. Legal-move and
+// status queries go to a quick queue that workers drain in batches and
+// always serve before searches. There are at least two workers and at most
+// workers - 1 searches run at once, so quick queries never wait behind
+// them. Answers are handed to the
+// reply callback a batch at a time, on a worker thread.
+class AnalysisPool {
+public:
+    typedef std::vector<std::pair<uint64_t, std::string>> Replies;    // (client, line)
+    typedef std::function<void(Replies &)> ReplyCallback;
+
+    static constexpr int QUICK_BATCH = 64;
+    static constexpr int64_t DEFAULT_MOVETIME_MS = 1000;    // bestmove with no limits
+    static constexpr int64_t MAX_MOVETIME_MS = 60000;
+
+    AnalysisPool(int workers, size_t hashMb, ReplyCallback reply);
+    ~AnalysisPool();
+    AnalysisPool(const AnalysisPool &) = delete;
+    AnalysisPool &operator=(const AnalysisPool &) = delete;
+
+    // Parses and queues one line from client. Malformed lines and stats
+    // requests are answered before this returns.
+    void submit(uint64_t client, const std::string &line);
+    AnalysisStats stats() const;
+    std::string statsJson(uint64_t id) const;
+    void shutdown();    // stops running searches; queued requests are dropped
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job {
+        uint64_t client;
+        AnalysisRequest request;
+        Clock::time_point received;
+    };
+
+    // The most recent latencies of one kind of request, in microseconds.
+    struct LatencyWindow {
+        static constexpr size_t SIZE = 8192;
+        std::vector<uint32_t> samples;
+        size_t next = 0;
+        uint64_t count = 0;
+
+        void add(uint32_t us);
+        AnalysisLatency summary() const;
+    };
+
+    void run();
+    void answer(Job &job, std::string &line);
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> quick, searches;
+    int runningSearches = 0;
+    int maxSearches;
+    bool quit = false;
+    std::atomic<bool> stopSearches{false};
+
+    mutable std::mutex statsMutex;
+    LatencyWindow latency[ANALYSIS_OPS];
+    uint64_t served = 0;
+
+    TranspositionTable tt;
+    ReplyCallback reply;
+    std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "bitboard.h"
+
+namespace {
+
+template <int N>
+constexpr SquareTable leaperTable(const int (&steps)[N][2]) {
+    SquareTable t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        int x = sq & 7, y = sq >> 3;
+        for (int i = 0; i < N; ++i) {
+            int tx = x + steps[i][0], ty = y + steps[i][1];
+            if (tx >= 0 && tx < 8 && ty >= 0 && ty < 8) t[sq] |= Bitboard(1) << (ty * 8 + tx);
+        }
+    }
+    return t;
+}
+
+constexpr int KNIGHT_STEPS[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+constexpr int KING_STEPS[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+constexpr int WHITE_PAWN_STEPS[2][2] = {{-1, -1}, {1, -1}};
+constexpr int BLACK_PAWN_STEPS[2][2] = {{-1, 1}, {1, 1}};
+
+constexpr int DIRECTIONS[8][2] = {{0, 1}, {1, 0}, {1, 1}, {-1, 1}, {0, -1}, {-1, 0}, {-1, -1}, {1, -1}};
+
+constexpr std::array<SquareTable, 64> lineTable(bool between) {
+    std::array<SquareTable, 64> t{};
+    for (int a = 0; a < 64; ++a) {
+        for (int d = 0; d < 8; ++d) {
+            const int *step = DIRECTIONS[d];
+            const int *back = DIRECTIONS[(d + 4) % 8];
+            Bitboard line = Bitboard(1) << a;
+            for (int x = (a & 7) + back[0], y = (a >> 3) + back[1]; x >= 0 && x < 8 && y >= 0 && y < 8; x += back[0], y += back[1])
+                line |= Bitboard(1) << (y * 8 + x);
+            for (int x = (a & 7) + step[0], y = (a >> 3) + step[1]; x >= 0 && x < 8 && y >= 0 && y < 8; x += step[0], y += step[1])
+                line |= Bitboard(1) << (y * 8 + x);
+
+            Bitboard path = 0;
+            for (int x = (a & 7) + step[0], y = (a >> 3) + step[1]; x >= 0 && x < 8 && y >= 0 && y < 8; x += step[0], y += step[1]) {
+                int b = y * 8 + x;
+                t[a][b] = between ? path : line;
+                path |= Bitboard(1) << b;
+            }
+        }
+    }
+    return t;
+}
+
+constexpr std::array<PieceType, 128> pieceTypeTable() {
+    std::array<PieceType, 128> t{};
+    for (int c = 0; c < 128; ++c) t[c] = NO_PIECE_TYPE;
+    const char *names = "PNBRQK";
+    for (int pt = PAWN; pt <= KING; ++pt) {
+        t[names[pt]] = PieceType(pt);
+        t[names[pt] - 'A' + 'a'] = PieceType(pt);
+    }
+    return t;
+}
+
+}
+
+extern constexpr SquareTable KNIGHT_ATTACKS = leaperTable(KNIGHT_STEPS);
+extern constexpr SquareTable KING_ATTACKS = leaperTable(KING_STEPS);
+extern constexpr std::array<SquareTable, 2> PAWN_ATTACKS = {
+    leaperTable(WHITE_PAWN_STEPS), leaperTable(BLACK_PAWN_STEPS)
+};
+extern constexpr std::array<SquareTable, 64> BETWEEN = lineTable(true);
+extern constexpr std::array<SquareTable, 64> LINE = lineTable(false);
+extern constexpr std::array<PieceType, 128> PIECE_TYPES = pieceTypeTable();
+
+char pieceChar(Color c, PieceType pt) {
+    const char *names = c == WHITE ? "PNBRQK" : "pnbrqk";
+    return pt == NO_PIECE_TYPE ? '.' : names[pt];
+}
+
+void Position::clear() {
+    for (int c = 0; c < 2; ++c) {
+        for (int pt = 0; pt < 6; ++pt) pieces[c][pt] = 0;
+        byColor[c] = 0;
+    }
+    occupied = 0;
+}
+
+void Position::put(int sq, char p) {
+    Color c = pieceColor(p);
+    Bitboard b = squareBB(sq);
+    pieces[c][pieceTypeOf(p)] |= b;
+    byColor[c] |= b;
+    occupied |= b;
+}
+
+void Position::remove(int sq, char p) {
+    Color c = pieceColor(p);
+    Bitboard b = ~squareBB(sq);
+    pieces[c][pieceTypeOf(p)] &= b;
+    byColor[c] &= b;
+    occupied &= b;
+}
+
+void Position::move(int from, int to, char p) {
+    Color c = pieceColor(p);
+    Bitboard b = squareBB(from) | squareBB(to);
+    pieces[c][pieceTypeOf(p)] ^= b;
+    byColor[c] ^= b;
+    occupied ^= b;
+}
+
+Bitboard Position::attackersTo(int sq, Bitboard occ) const {
+    return (PAWN_ATTACKS[BLACK][sq] & pieces[WHITE][PAWN])
+         | (PAWN_ATTACKS[WHITE][sq] & pieces[BLACK][PAWN])
+         | (KNIGHT_ATTACKS[sq] & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT]))
+         | (KING_ATTACKS[sq] & (pieces[WHITE][KING] | pieces[BLACK][KING]))
+         | (bishopAttacks(sq, occ) & (pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP]
+                                      | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]))
+         | (rookAttacks(sq, occ) & (pieces[WHITE][ROOK] | pieces[BLACK][ROOK]
+                                    | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]));
+}
@@ -0,0 +1,185 @@
+#ifndef CHESS_BITBOARD_H
+#define CHESS_BITBOARD_H
+
+#include <array>
+#include <cstdint>
+
+typedef uint64_t Bitboard;
+
+enum Color { WHITE, BLACK };
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE_TYPE };
+
+// Squares follow GameState::board[y][x]: sq = y * 8 + x, so a8 = 0 and h1 = 63.
+inline int makeSquare(int x, int y) { return y * 8 + x; }
+inline int squareX(int sq) { return sq & 7; }
+inline int squareY(int sq) { return sq >> 3; }
+inline Bitboard squareBB(int sq) { return Bitboard(1) << sq; }
+
+inline int popcount(Bitboard b) { return __builtin_popcountll(b); }
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+inline int msb(Bitboard b) { return 63 - __builtin_clzll(b); }
+inline int popLsb(Bitboard &b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+const Bitboard ROW_1 = 0xFFull << 56;    // white's back rank
+const Bitboard ROW_2 = 0xFFull << 48;
+const Bitboard ROW_7 = 0xFFull << 8;
+const Bitboard ROW_8 = 0xFFull;          // black's back rank
+
+typedef std::array<Bitboard, 64> SquareTable;
+
+extern const SquareTable KNIGHT_ATTACKS;
+extern const SquareTable KING_ATTACKS;
+extern const std::array<SquareTable, 2> PAWN_ATTACKS;    // squares a pawn of that color attacks
+extern const std::array<SquareTable, 64> BETWEEN;        // squares strictly between two aligned squares
+extern const std::array<SquareTable, 64> LINE;           // whole line through two aligned squares
+
+// Slider attacks come from tables built at compile time (magic.cpp). Each
+// square's block is indexed either by a magic multiply-shift or, on CPUs
+// with BMI2, by pext(occupied, mask); both layouts share the same offsets.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    unsigned offset;
+    unsigned shift;
+};
+
+const int SLIDER_TABLE_SIZE = 102400 + 5248;
+
+struct SliderTables {
+    std::array<Magic, 64> rook;
+    std::array<Magic, 64> bishop;
+    std::array<Bitboard, SLIDER_TABLE_SIZE> magicAttacks;
+    std::array<Bitboard, SLIDER_TABLE_SIZE> pextAttacks;
+};
+
+extern const SliderTables SLIDERS;
+
+enum SliderBackend { SLIDERS_MAGIC, SLIDERS_PEXT };
+
+extern bool slidersUsePext;
+bool cpuHasPext();
+bool setSliderBackend(SliderBackend backend);    // false if the CPU lacks BMI2
+SliderBackend sliderBackend();
+
+// Emitted as inline asm so the pext path inlines into callers built for
+// the baseline ISA; only executed when slidersUsePext is set.
+inline Bitboard pext(Bitboard value, Bitboard mask) {
+#if defined(__BMI2__)
+    return __builtin_ia32_pext_di(value, mask);
+#elif defined(__x86_64__) && defined(__GNUC__)
+    Bitboard result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(value), "r"(mask));
+    return result;
+#else
+    Bitboard result = 0;
+    for (Bitboard bit = 1; mask; bit <<= 1, mask &= mask - 1)
+        if (value & mask & -mask) result |= bit;
+    return result;
+#endif
+}
+
+inline Bitboard bishopAttacksPext(int sq, Bitboard occupied) {
+    const Magic &m = SLIDERS.bishop[sq];
+    return SLIDERS.pextAttacks[m.offset + pext(occupied, m.mask)];
+}
+
+inline Bitboard rookAttacksPext(int sq, Bitboard occupied) {
+    const Magic &m = SLIDERS.rook[sq];
+    return SLIDERS.pextAttacks[m.offset + pext(occupied, m.mask)];
+}
+
+inline Bitboard bishopAttacksMagic(int sq, Bitboard occupied) {
+    const Magic &m = SLIDERS.bishop[sq];
+    return SLIDERS.magicAttacks[m.offset + (((occupied & m.mask) * m.magic) >> m.shift)];
+}
+
+inline Bitboard rookAttacksMagic(int sq, Bitboard occupied) {
+    const Magic &m = SLIDERS.rook[sq];
+    return SLIDERS.magicAttacks[m.offset + (((occupied & m.mask) * m.magic) >> m.shift)];
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    return slidersUsePext ? bishopAttacksPext(sq, occupied) : bishopAttacksMagic(sq, occupied);
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    return slidersUsePext ? rookAttacksPext(sq, occupied) : rookAttacksMagic(sq, occupied);
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+inline Color pieceColor(char p) { return (p >= 'a' && p <= 'z') ? BLACK : WHITE; }
+extern const std::array<PieceType, 128> PIECE_TYPES;    // indexed by piece letter
+inline PieceType pieceTypeOf(char p) { return PIECE_TYPES[p & 127]; }
+char pieceChar(Color c, PieceType pt);
+
+struct Position {
+    Bitboard pieces[2][6];
+    Bitboard byColor[2];
+    Bitboard occupied;
+
+    void clear();
+    void put(int sq, char p);
+    void remove(int sq, char p);
+    void move(int from, int to, char p);
+    Bitboard attackersTo(int sq, Color by, Bitboard occ) const;
+    Bitboard attackersTo(int sq, Bitboard occ) const;    // both colors
+    bool attacked(int sq, Color by, Bitboard occ) const;
+    bool attacked(int sq, Color by) const { return attacked(sq, by, occupied); }
+    int kingSquare(Color c) const { return lsb(pieces[c][KING]); }
+
+    // The same with the color fixed at compile time, for the move generator
+    // and make/unmake, which dispatch on the side to move once per node.
+    template <Color C> void put(int sq, PieceType t) {
+        Bitboard b = squareBB(sq);
+        pieces[C][t] |= b;
+        byColor[C] |= b;
+        occupied |= b;
+    }
+    template <Color C> void remove(int sq, PieceType t) {
+        Bitboard b = ~squareBB(sq);
+        pieces[C][t] &= b;
+        byColor[C] &= b;
+        occupied &= b;
+    }
+    template <Color C> void move(int from, int to, PieceType t) {
+        Bitboard b = squareBB(from) | squareBB(to);
+        pieces[C][t] ^= b;
+        byColor[C] ^= b;
+        occupied ^= b;
+    }
+    template <Color By> Bitboard attackersTo(int sq, Bitboard occ) const {
+        const Bitboard *p = pieces[By];
+        return (PAWN_ATTACKS[By ^ 1][sq] & p[PAWN])
+             | (KNIGHT_ATTACKS[sq] & p[KNIGHT])
+             | (KING_ATTACKS[sq] & p[KING])
+             | (bishopAttacks(sq, occ) & (p[BISHOP] | p[QUEEN]))
+             | (rookAttacks(sq, occ) & (p[ROOK] | p[QUEEN]));
+    }
+    template <Color By> bool attacked(int sq, Bitboard occ) const {
+        const Bitboard *p = pieces[By];
+        if (PAWN_ATTACKS[By ^ 1][sq] & p[PAWN]) return true;
+        if (KNIGHT_ATTACKS[sq] & p[KNIGHT]) return true;
+        if (KING_ATTACKS[sq] & p[KING]) return true;
+        Bitboard diagonal = p[BISHOP] | p[QUEEN];
+        if (diagonal && (bishopAttacks(sq, occ) & diagonal)) return true;
+        Bitboard straight = p[ROOK] | p[QUEEN];
+        return straight && (rookAttacks(sq, occ) & straight);
+    }
+};
+
+inline Bitboard Position::attackersTo(int sq, Color by, Bitboard occ) const {
+    return by == WHITE ? attackersTo<WHITE>(sq, occ) : attackersTo<BLACK>(sq, occ);
+}
+
+inline bool Position::attacked(int sq, Color by, Bitboard occ) const {
+    return by == WHITE ? attacked<WHITE>(sq, occ) : attacked<BLACK>(sq, occ);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CHESS_BOOK_H
+#define CHESS_BOOK_H
+
+#include "mappedfile.h"
+#include "rules.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum BookSelection { BOOK_BEST, BOOK_WEIGHTED };
+
+struct BookMove {
+    Move move;
+    int weight;
+};
+
+const int MAX_BOOK_MOVES = 64;
+
+// The standard Polyglot key of the position on g.board, as used by .bin books.
+uint64_t polyglotKey(const GameState &g);
+
+// Read-only Polyglot book. The file is memory-mapped, not loaded, and each
+// lookup is a binary search over the mapped entries, so opening a large book
+// costs no heap and a probe touches only a few pages. Lookups are const and
+// may run concurrently from any thread.
+class OpeningBook {
+public:
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    size_t entryCount() const { return entries; }
+
+    // The legal book moves for g in book order (heaviest first), at most max.
+    int lookup(const GameState &g, BookMove *out, int max) const;
+
+    // BOOK_BEST plays the heaviest move; BOOK_WEIGHTED picks one in
+    // proportion to its weight, using random as the die roll.
+    bool probe(const GameState &g, Move &out, BookSelection selection = BOOK_WEIGHTED,
+               uint64_t random = 0) const;
+
+private:
+    MappedFile file;
+    size_t entries = 0;
+};
+
+#endif
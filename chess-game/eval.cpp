@@ -0,0 +1,32 @@
+#include "eval.h"
+
+#include <algorithm>
+
+namespace {
+
+// Blends the two halves by the material left: all middlegame at the
+// starting phase or above (early promotions), all endgame with pawns only.
+int taper(const Score &score, int phase) {
+    phase = std::min(phase, PHASE_MAX);
+    return (score.mg * phase + score.eg * (PHASE_MAX - phase)) / PHASE_MAX;
+}
+
+}
+
+int evaluate(const GameState &g) {
+    if (g.nnue) return g.nnue->evaluate(g.nnueStack.back(), g.whiteTurn ? WHITE : BLACK);
+    int score = taper(g.psq, g.phase);
+    return g.whiteTurn ? score : -score;
+}
+
+int evaluateFull(const GameState &g) {
+    if (g.nnue) {
+        NnueAccumulator acc;
+        g.nnue->refresh(g.pos, acc);
+        return g.nnue->evaluate(acc, g.whiteTurn ? WHITE : BLACK);
+    }
+    int phase;
+    Score psq = computePsq(g.pos, phase);
+    int score = taper(psq, phase);
+    return g.whiteTurn ? score : -score;
+}
@@ -0,0 +1,18 @@
+#ifndef CHESS_EVAL_H
+#define CHESS_EVAL_H
+
+#include "rules.h"
+
+const int PIECE_VALUES[6] = {100, 320, 330, 500, 900, 0};    // middlegame; also used for move ordering
+const int PIECE_VALUES_EG[6] = {120, 290, 320, 530, 950, 0};
+
+// Static score in centipawns from the side to move's point of view: tapered
+// material and piece-square terms. evaluate() reads the sums makeMove and
+// undoMove keep in GameState, so it costs the same at every leaf;
+// evaluateFull() rescans the board and is the reference it must agree with.
+// With a network attached (setNnue) both use it instead, from the kept
+// accumulator and from a fresh one respectively.
+int evaluate(const GameState &g);
+int evaluateFull(const GameState &g);
+
+#endif
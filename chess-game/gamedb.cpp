@@ -0,0 +1,521 @@
+#include "gamedb.h"
+#include "pgn.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+
+namespace {
+
+const char MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'G', 'D', 'B'};
+const uint32_t VERSION = 1;
+const size_t HEADER_BYTES = 64;
+const size_t GAME_BYTES = 24;
+const size_t ENTRY_BYTES = 16;
+const uint32_t GAME_MASK = (1u << 30) - 1;    // the index keeps the result in the top two bits
+const uint8_t FLAG_FEN = 1;                   // starts from the FEN tag
+const int MAX_ERRORS = 20;
+const char *STORED_TAGS[] = {"Event", "Site", "Date", "Round", "White", "Black", "WhiteElo", "BlackElo", "ECO", "FEN"};
+
+inline uint64_t readLittleEndian(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = v << 8 | p[i];
+    return v;
+}
+
+inline size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// Buffered little-endian output.
+class Writer {
+public:
+    explicit Writer(FILE *f) : file(f) { buffer.reserve(BUFFER); }
+    ~Writer() { flush(); }
+
+    void put(uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) buffer.push_back((unsigned char)(value >> (8 * i)));
+        written += bytes;
+        if (buffer.size() >= BUFFER) flush();
+    }
+    void putBytes(const char *p, size_t n) {
+        buffer.insert(buffer.end(), p, p + n);
+        written += n;
+        if (buffer.size() >= BUFFER) flush();
+    }
+    void padTo8() {
+        while (written % 8) put(0, 1);
+    }
+    bool flush() {
+        if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) failed = true;
+        buffer.clear();
+        return !failed;
+    }
+
+    uint64_t written = 0;
+    bool failed = false;
+
+private:
+    static const size_t BUFFER = 1 << 20;
+    FILE *file;
+    std::vector<unsigned char> buffer;
+};
+
+struct IndexEntry {
+    uint64_t key;
+    uint32_t game;    // id | result << 30
+    uint16_t ply;
+    uint16_t next;
+};
+
+inline bool entryLess(const IndexEntry &a, const IndexEntry &b) {
+    if (a.key != b.key) return a.key < b.key;
+    uint32_t ga = a.game & GAME_MASK, gb = b.game & GAME_MASK;
+    return ga != gb ? ga < gb : a.ply < b.ply;
+}
+
+// Merges sorted sequences, each behind a callback that yields its next
+// entry, in entryLess order.
+template <typename Source, typename Sink>
+void mergeSources(std::vector<Source> &sources, Sink sink) {
+    typedef std::pair<IndexEntry, size_t> Head;
+    auto greater = [](const Head &a, const Head &b) { return entryLess(b.first, a.first); };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+    IndexEntry e;
+    for (size_t i = 0; i < sources.size(); ++i)
+        if (sources[i](e)) heads.push(Head(e, i));
+    while (!heads.empty()) {
+        Head h = heads.top();
+        heads.pop();
+        sink(h.first);
+        if (sources[h.second](e)) heads.push(Head(e, h.second));
+    }
+}
+
+// Collects index entries and writes them out as sorted runs. One buffer
+// fills while the other is sorted and written on a background thread.
+class RunWriter {
+public:
+    RunWriter(const std::string &prefix, int threads, size_t capacity)
+        : prefix(prefix), threads(std::max(1, threads)), capacity(std::max<size_t>(capacity, 1024)) {
+        filling.reserve(this->capacity);
+    }
+    ~RunWriter() {
+        if (sorter.joinable()) sorter.join();
+        for (const std::string &run : runs) std::remove(run.c_str());
+    }
+
+    void add(const IndexEntry &e) {
+        filling.push_back(e);
+        if (filling.size() == capacity) spill();
+    }
+
+    // False if a run could not be written.
+    bool finish() {
+        if (!filling.empty()) spill();
+        if (sorter.joinable()) sorter.join();
+        std::vector<IndexEntry>().swap(filling);
+        std::vector<IndexEntry>().swap(sorting);
+        return !failed;
+    }
+
+    std::vector<std::string> runs;
+
+private:
+    void spill() {
+        if (sorter.joinable()) sorter.join();
+        sorting.swap(filling);
+        filling.clear();
+        filling.reserve(capacity);
+        runs.push_back(prefix + ".run" + std::to_string(runs.size()) + ".tmp");
+        sorter = std::thread(&RunWriter::writeRun, this, runs.back());
+    }
+
+    // Sorts slices of the buffer in parallel, then merges them into the run.
+    void writeRun(std::string path) {
+        size_t n = sorting.size(), slices = std::min<size_t>(threads, (n + 4095) / 4096);
+        std::vector<std::pair<IndexEntry *, IndexEntry *>> ranges;
+        for (size_t i = 0; i < slices; ++i)
+            ranges.emplace_back(sorting.data() + n * i / slices, sorting.data() + n * (i + 1) / slices);
+        std::vector<std::thread> helpers;
+        for (size_t i = 1; i < slices; ++i)
+            helpers.emplace_back([&ranges, i] { std::sort(ranges[i].first, ranges[i].second, entryLess); });
+        std::sort(ranges[0].first, ranges[0].second, entryLess);
+        for (std::thread &t : helpers) t.join();
+
+        FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f) {
+            failed = true;
+            return;
+        }
+        std::vector<IndexEntry> out;
+        out.reserve(1 << 16);
+        auto write = [&] {
+            if (std::fwrite(out.data(), sizeof(IndexEntry), out.size(), f) != out.size()) failed = true;
+            out.clear();
+        };
+        std::vector<std::function<bool(IndexEntry &)>> sources;
+        for (auto &r : ranges)
+            sources.push_back([&r](IndexEntry &e) {
+                if (r.first == r.second) return false;
+                e = *r.first++;
+                return true;
+            });
+        mergeSources(sources, [&](const IndexEntry &e) {
+            out.push_back(e);
+            if (out.size() == out.capacity()) write();
+        });
+        write();
+        if (std::fclose(f) != 0) failed = true;
+    }
+
+    std::string prefix;
+    int threads;
+    size_t capacity;
+    std::vector<IndexEntry> filling, sorting;
+    std::thread sorter;
+    bool failed = false;    // written by the sorter, read after joining it
+};
+
+// Reads a run back in blocks.
+class RunReader {
+public:
+    RunReader(const std::string &path, size_t block) : file(std::fopen(path.c_str(), "rb")), buffer(block) {}
+    ~RunReader() {
+        if (file) std::fclose(file);
+    }
+    RunReader(const RunReader &) = delete;
+
+    bool isOpen() const { return file != NULL; }
+    bool next(IndexEntry &e) {
+        if (pos == count) {
+            count = file ? std::fread(buffer.data(), sizeof(IndexEntry), buffer.size(), file) : 0;
+            pos = 0;
+            if (!count) return false;
+        }
+        e = buffer[pos++];
+        return true;
+    }
+
+private:
+    FILE *file;
+    std::vector<IndexEntry> buffer;
+    size_t pos = 0, count = 0;
+};
+
+bool copyFile(FILE *from, Writer &to) {
+    std::rewind(from);
+    std::vector<char> buffer(1 << 20);
+    size_t n;
+    while ((n = std::fread(buffer.data(), 1, buffer.size(), from)) > 0) to.putBytes(buffer.data(), n);
+    return !std::ferror(from);
+}
+
+bool isStoredTag(const std::string &name) {
+    for (const char *tag : STORED_TAGS)
+        if (name == tag) return true;
+    return false;
+}
+
+}
+
+const char *dbResultName(DbResult result) {
+    switch (result) {
+        case DB_WHITE_WINS: return "1-0";
+        case DB_BLACK_WINS: return "0-1";
+        case DB_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+DbResult dbResultFromText(const std::string &text) {
+    if (text == "1-0") return DB_WHITE_WINS;
+    if (text == "0-1") return DB_BLACK_WINS;
+    if (text == "1/2-1/2") return DB_DRAW;
+    return DB_UNKNOWN;
+}
+
+std::string dbTag(const std::string &tags, const char *name) {
+    size_t length = std::strlen(name);
+    for (size_t start = 0; start < tags.size();) {
+        size_t end = tags.find('\n', start);
+        if (end == std::string::npos) end = tags.size();
+        if (end - start > length && tags[start + length] == '\t' && !tags.compare(start, length, name))
+            return tags.substr(start + length + 1, end - start - length - 1);
+        start = end + 1;
+    }
+    return "";
+}
+
+bool GameDatabase::open(const std::string &path) {
+    close();
+    if (!file.open(path)) return false;
+    const unsigned char *d = file.data();
+    size_t size = file.size();
+    if (size < HEADER_BYTES || std::memcmp(d, MAGIC, 8) || readLittleEndian(d + 8, 4) != VERSION) {
+        close();
+        return false;
+    }
+    games = readLittleEndian(d + 16, 8);
+    moves = readLittleEndian(d + 24, 8);
+    tagBytes = readLittleEndian(d + 32, 8);
+    positions = readLittleEndian(d + 40, 8);
+    // Each count is checked against the size before it is multiplied, so a
+    // damaged header cannot overflow the offsets.
+    if (moves > size || games > size || tagBytes > size || positions > size) {
+        close();
+        return false;
+    }
+    size_t gameOffset = align8(HEADER_BYTES + 2 * moves);
+    size_t tagOffset = gameOffset + GAME_BYTES * games;
+    size_t indexOffset = align8(tagOffset + tagBytes);
+    if (indexOffset + ENTRY_BYTES * positions > size) {
+        close();
+        return false;
+    }
+    moveData = d + HEADER_BYTES;
+    gameData = d + gameOffset;
+    tagData = d + tagOffset;
+    indexData = d + indexOffset;
+    return true;
+}
+
+void GameDatabase::close() {
+    file.close();
+    games = moves = tagBytes = positions = 0;
+    moveData = gameData = tagData = indexData = nullptr;
+}
+
+bool GameDatabase::game(uint64_t id, DbGame &out) const {
+    if (id >= games) return false;
+    const unsigned char *r = gameData + id * GAME_BYTES;
+    uint64_t first = readLittleEndian(r, 8), tagOffset = readLittleEndian(r + 8, 8);
+    uint64_t plies = readLittleEndian(r + 16, 4), tagLength = readLittleEndian(r + 20, 2);
+    if (first + plies > moves || tagOffset + tagLength > tagBytes) return false;
+    out.id = id;
+    out.plies = int(plies);
+    out.result = DbResult(r[22] & 3);
+    out.tags.assign(reinterpret_cast<const char *>(tagData + tagOffset), size_t(tagLength));
+    return true;
+}
+
+PackedMove GameDatabase::move(uint64_t id, int ply) const {
+    if (id >= games || ply < 0) return 0;
+    const unsigned char *r = gameData + id * GAME_BYTES;
+    uint64_t first = readLittleEndian(r, 8), plies = readLittleEndian(r + 16, 4);
+    if (uint64_t(ply) >= plies || first + plies > moves) return 0;
+    return PackedMove(readLittleEndian(moveData + 2 * (first + ply), 2));
+}
+
+bool GameDatabase::replay(uint64_t id, GameState &g, int ply) const {
+    DbGame info;
+    if (!game(id, info)) return false;
+    const unsigned char *r = gameData + id * GAME_BYTES;
+    if (r[23] & FLAG_FEN) {
+        if (!loadFen(g, dbTag(info.tags, "FEN"))) return false;
+    } else {
+        initBoard(g);
+    }
+    int n = ply < 0 ? info.plies : std::min(ply, info.plies);
+    for (int i = 0; i < n; ++i) {
+        // Checked against the legal moves, so a damaged file cannot corrupt g.
+        Move m = unpackMove(move(id, i)), legal;
+        if (!findLegalMove(g, m.sx, m.sy, m.tx, m.ty, m.promotion, legal)) return false;
+        makeMove(g, legal);
+    }
+    return true;
+}
+
+const unsigned char *GameDatabase::entryRange(uint64_t key, const unsigned char *&end) const {
+    auto lowerBound = [this](uint64_t k) {
+        size_t lo = 0, hi = positions;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (readLittleEndian(indexData + mid * ENTRY_BYTES, 8) < k) lo = mid + 1;
+            else hi = mid;
+        }
+        return indexData + lo * ENTRY_BYTES;
+    };
+    const unsigned char *begin = lowerBound(key);
+    end = begin;
+    while (end < indexData + positions * ENTRY_BYTES && readLittleEndian(end, 8) == key) end += ENTRY_BYTES;
+    return begin;
+}
+
+uint64_t GameDatabase::find(const GameState &g, std::vector<DbHit> &out, size_t max) const {
+    out.clear();
+    if (!isOpen()) return 0;
+    const unsigned char *end, *e = entryRange(g.hash, end);
+    uint64_t count = 0, last = UINT64_MAX;
+    for (; e < end; e += ENTRY_BYTES) {
+        uint32_t word = uint32_t(readLittleEndian(e + 8, 4));
+        uint32_t id = word & GAME_MASK;
+        if (id == last) continue;    // a repetition within the same game
+        last = id;
+        ++count;
+        if (!max || out.size() < max) out.push_back(DbHit{id, int(readLittleEndian(e + 12, 2)), DbResult(word >> 30)});
+    }
+    return count;
+}
+
+DbExplorer GameDatabase::explore(const GameState &g) const {
+    DbExplorer x;
+    if (!isOpen()) return x;
+    auto count = [](DbResultCounts &c, DbResult r) {
+        ++c.games;
+        if (r == DB_WHITE_WINS) ++c.whiteWins;
+        else if (r == DB_BLACK_WINS) ++c.blackWins;
+        else if (r == DB_DRAW) ++c.draws;
+    };
+    const unsigned char *end, *e = entryRange(g.hash, end);
+    uint64_t last = UINT64_MAX;
+    for (; e < end; e += ENTRY_BYTES) {
+        uint32_t word = uint32_t(readLittleEndian(e + 8, 4));
+        if ((word & GAME_MASK) == last) continue;
+        last = word & GAME_MASK;
+        DbResult result = DbResult(word >> 30);
+        count(x.total, result);
+        PackedMove next = PackedMove(readLittleEndian(e + 14, 2));
+        if (!next) continue;
+        auto it = std::find_if(x.moves.begin(), x.moves.end(), [next](const DbNextMove &m) { return m.move == next; });
+        if (it == x.moves.end()) it = x.moves.insert(x.moves.end(), DbNextMove{next, DbResultCounts()});
+        count(it->results, result);
+    }
+    std::stable_sort(x.moves.begin(), x.moves.end(),
+                     [](const DbNextMove &a, const DbNextMove &b) { return a.results.games > b.results.games; });
+    return x;
+}
+
+bool buildGameDatabase(const std::string &pgnPath, const std::string &outPath, const DbBuildOptions &options,
+                       DbBuildStats &stats, std::string &error) {
+    auto t0 = std::chrono::steady_clock::now();
+    stats = DbBuildStats();
+    std::string gamesPath = outPath + ".games.tmp", tagsPath = outPath + ".tags.tmp";
+    FILE *out = std::fopen(outPath.c_str(), "wb");
+    FILE *gamesFile = std::fopen(gamesPath.c_str(), "w+b");
+    FILE *tagsFile = std::fopen(tagsPath.c_str(), "w+b");
+    auto cleanUp = [&] {
+        for (FILE *f : {out, gamesFile, tagsFile})
+            if (f) std::fclose(f);
+        std::remove(gamesPath.c_str());
+        std::remove(tagsPath.c_str());
+    };
+    if (!out || !gamesFile || !tagsFile) {
+        error = "cannot create " + (out ? gamesPath : outPath);
+        cleanUp();
+        return false;
+    }
+
+    bool ok = true;
+    uint64_t tagBytes = 0;
+    {
+        Writer moveOut(out), gameOut(gamesFile), tagOut(tagsFile);
+        for (size_t i = 0; i < HEADER_BYTES; ++i) moveOut.put(0, 1);
+        RunWriter runs(outPath, options.threads, options.sortMemory / 2 / sizeof(IndexEntry));
+
+        PgnOptions pgn;
+        pgn.threads = options.threads;
+        pgn.keepRecord = true;
+        std::string tags;
+        PgnStats pgnStats;
+        bool opened = checkPgnFile(pgnPath, pgn, [&](const std::vector<PgnGame> &chunk) {
+            for (const PgnGame &game : chunk) {
+                if (!game.error.empty() || stats.games > GAME_MASK) {
+                    ++stats.skipped;
+                    if (stats.errors.size() < size_t(MAX_ERRORS))
+                        stats.errors.push_back("game " + std::to_string(game.index) + ": "
+                                               + (game.error.empty() ? "too many games" : game.error));
+                    continue;
+                }
+                uint32_t id = uint32_t(stats.games++);
+                DbResult result = dbResultFromText(game.result);
+                uint8_t flags = 0;
+                tags.clear();
+                for (const auto &tag : game.tags) {
+                    if (!isStoredTag(tag.first)) continue;
+                    if (tag.first == "FEN") flags |= FLAG_FEN;
+                    std::string value = tag.second;
+                    std::replace(value.begin(), value.end(), '\t', ' ');
+                    std::replace(value.begin(), value.end(), '\n', ' ');
+                    tags += tag.first + '\t' + value + '\n';
+                }
+                tags.resize(std::min<size_t>(tags.size(), 0xffff));
+
+                gameOut.put(stats.plies, 8);
+                gameOut.put(tagOut.written, 8);
+                gameOut.put(game.moves.size(), 4);
+                gameOut.put(tags.size(), 2);
+                gameOut.put(result, 1);
+                gameOut.put(flags, 1);
+                tagOut.putBytes(tags.data(), tags.size());
+                for (PackedMove m : game.moves) moveOut.put(m, 2);
+
+                size_t last = std::min<size_t>(game.moves.size(), 0xffff);
+                if (options.maxIndexPly > 0) last = std::min<size_t>(last, size_t(options.maxIndexPly));
+                for (size_t ply = 0; ply <= last; ++ply)
+                    runs.add(IndexEntry{game.keys[ply], id | uint32_t(result) << 30, uint16_t(ply),
+                                        uint16_t(ply < game.moves.size() ? game.moves[ply] : 0)});
+                stats.plies += game.moves.size();
+                stats.positions += last + 1;
+            }
+        }, pgnStats);
+        if (!opened) {
+            error = "cannot open " + pgnPath;
+            ok = false;
+        } else if (!runs.finish()) {
+            error = "cannot write the sorted runs next to " + outPath;
+            ok = false;
+        }
+
+        if (ok) {
+            moveOut.padTo8();
+            ok = gameOut.flush() && tagOut.flush() && copyFile(gamesFile, moveOut) && copyFile(tagsFile, moveOut);
+            moveOut.padTo8();
+            // Each run gets an equal share of the sort memory as its read buffer.
+            size_t block = std::max<size_t>(4096, options.sortMemory / sizeof(IndexEntry) / std::max<size_t>(1, runs.runs.size()));
+            std::vector<std::unique_ptr<RunReader>> readers;
+            std::vector<std::function<bool(IndexEntry &)>> sources;
+            for (const std::string &path : runs.runs) {
+                readers.emplace_back(new RunReader(path, block));
+                if (!readers.back()->isOpen()) ok = false;
+                RunReader *r = readers.back().get();
+                sources.push_back([r](IndexEntry &e) { return r->next(e); });
+            }
+            stats.runs = runs.runs.size();
+            uint64_t merged = 0;
+            mergeSources(sources, [&](const IndexEntry &e) {
+                moveOut.put(e.key, 8);
+                moveOut.put(e.game, 4);
+                moveOut.put(e.ply, 2);
+                moveOut.put(e.next, 2);
+                ++merged;
+            });
+            ok = ok && merged == stats.positions && moveOut.flush();
+            stats.bytes = moveOut.written;
+            tagBytes = tagOut.written;
+            if (!ok) error = "cannot write " + outPath;
+        }
+    }
+
+    if (ok) {
+        unsigned char header[HEADER_BYTES] = {};
+        std::memcpy(header, MAGIC, 8);
+        auto field = [&header](size_t offset, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) header[offset + i] = (unsigned char)(value >> (8 * i));
+        };
+        field(8, VERSION, 4);
+        field(16, stats.games, 8);
+        field(24, stats.plies, 8);
+        field(32, tagBytes, 8);
+        field(40, stats.positions, 8);
+        ok = std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(header, 1, HEADER_BYTES, out) == HEADER_BYTES;
+        if (!ok) error = "cannot write " + outPath;
+    }
+    cleanUp();
+    if (!ok) std::remove(outPath.c_str());
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return ok;
+}
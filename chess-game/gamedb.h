@@ -0,0 +1,125 @@
+#ifndef CHESS_GAMEDB_H
+#define CHESS_GAMEDB_H
+
+#include "mappedfile.h"
+#include "rules.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A game database file, little-endian throughout:
+//
+//   header     64 bytes: "CHESSGDB", version, then the game, move,
+//              tag-byte and position counts
+//   moves      every game's PackedMoves, one game after another
+//   games      24 bytes per game: first move, tag offset, plies, tag
+//              length, result, flags
+//   tags       "Name\tValue\n" lines, a few per game
+//   index      16 bytes per position reached: Zobrist key, game id with
+//              the result in its top two bits, ply, and the move played
+//              next (0 after the last). Sorted by key, then game and ply.
+//
+// Sections after the moves start on 8-byte boundaries. Opened files are
+// mapped, not read; a position query is a binary search in the index and
+// a scan of the entries with its key.
+
+enum DbResult : uint8_t { DB_UNKNOWN, DB_WHITE_WINS, DB_BLACK_WINS, DB_DRAW };
+
+const char *dbResultName(DbResult result);    // "1-0", "0-1", "1/2-1/2", "*"
+DbResult dbResultFromText(const std::string &text);
+
+struct DbGame {
+    uint64_t id = 0;
+    int plies = 0;
+    DbResult result = DB_UNKNOWN;
+    std::string tags;    // as stored; see tag()
+};
+
+// One game reaching a position, at the first ply it did.
+struct DbHit {
+    uint32_t game;
+    int ply;
+    DbResult result;
+};
+
+struct DbResultCounts {
+    uint64_t games = 0;
+    uint64_t whiteWins = 0;
+    uint64_t draws = 0;
+    uint64_t blackWins = 0;
+};
+
+struct DbNextMove {
+    PackedMove move;
+    DbResultCounts results;
+};
+
+// What an opening explorer shows for a position: how the games that
+// reached it ended, and the moves played from it with their results, most
+// played first.
+struct DbExplorer {
+    DbResultCounts total;
+    std::vector<DbNextMove> moves;
+};
+
+// Read-only and const after open, so queries may run concurrently.
+class GameDatabase {
+public:
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    uint64_t gameCount() const { return games; }
+    uint64_t positionCount() const { return positions; }
+
+    bool game(uint64_t id, DbGame &out) const;
+    PackedMove move(uint64_t id, int ply) const;    // 0 past the end
+    // Plays game id up to ply (all of it if ply is negative) from its
+    // starting position into g. False if the stored FEN or a move does not
+    // replay, as in a damaged or hand-edited file.
+    bool replay(uint64_t id, GameState &g, int ply = -1) const;
+
+    // The games that reached g's position, in id order, at most max of them
+    // (0 for all). Returns how many games reached it, max or not.
+    uint64_t find(const GameState &g, std::vector<DbHit> &out, size_t max = 0) const;
+    DbExplorer explore(const GameState &g) const;
+
+private:
+    const unsigned char *entryRange(uint64_t key, const unsigned char *&end) const;
+
+    MappedFile file;
+    uint64_t games = 0, moves = 0, tagBytes = 0, positions = 0;
+    const unsigned char *moveData = nullptr, *gameData = nullptr, *tagData = nullptr, *indexData = nullptr;
+};
+
+// The value of one tag in DbGame::tags, or "" if absent.
+std::string dbTag(const std::string &tags, const char *name);
+
+struct DbBuildOptions {
+    int threads = 1;
+    size_t sortMemory = size_t(256) << 20;    // for sorting index entries, in two halves
+    int maxIndexPly = 0;                      // index positions up to this ply only; 0 for all
+};
+
+struct DbBuildStats {
+    uint64_t games = 0;
+    uint64_t skipped = 0;    // games that failed to replay
+    uint64_t plies = 0;
+    uint64_t positions = 0;
+    uint64_t runs = 0;       // sorted runs merged into the index
+    uint64_t bytes = 0;      // size of the database
+    double seconds = 0;
+    std::vector<std::string> errors;    // the first few skipped games' errors
+};
+
+// Imports a PGN file. The games are replayed on the PGN reader's
+// work-stealing pool. Index entries are collected in memory and sorted in
+// runs: while one half of sortMemory fills, the other is sorted in slices
+// on the worker threads and written to a temporary file next to outPath.
+// The runs are then merged into the index. The database's size is not
+// limited by memory.
+bool buildGameDatabase(const std::string &pgnPath, const std::string &outPath, const DbBuildOptions &options,
+                       DbBuildStats &stats, std::string &error);
+
+#endif
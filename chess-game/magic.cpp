@@ -0,0 +1,142 @@
+#include "bitboard.h"
+
+namespace {
+
+// Magic multipliers for the a8 = 0 square layout, found offline with a
+// sparse-random search. buildSliderTables() rejects any that collide.
+constexpr Bitboard ROOK_MAGIC_NUMBERS[64] = {
+    0x1080004008801020ull, 0x0840092002C03000ull, 0x1900200010400900ull, 0x0880100008000480ull,
+    0x4200100420080200ull, 0x8100020100080400ull, 0x0200040110886200ull, 0x0200008040220411ull,
+    0x0404800084400220ull, 0x0000401000402000ull, 0x0086001081220440ull, 0x0408800800100280ull,
+    0x000A001201040820ull, 0x8848800200840080ull, 0x4001000100040200ull, 0x0442000102105084ull,
+    0x9080010020804100ull, 0x0040404000201009ull, 0x0000808010002009ull, 0x2200090021D00100ull,
+    0x0008008008040080ull, 0x0004004002010040ull, 0x0011040008015042ull, 0x00000A0001768104ull,
+    0x0000800080204009ull, 0x2010004140002001ull, 0x9800200280100080ull, 0x1000100080080080ull,
+    0x0442000A00049020ull, 0x2100040080020080ull, 0x0800120400900148ull, 0x0010040A00128541ull,
+    0x2800804000800030ull, 0x1010002000400041ull, 0x4000200011004100ull, 0x0610008410800800ull,
+    0x0400802402800800ull, 0xC100020080800400ull, 0x0002000802000401ull, 0x0182085882000401ull,
+    0x0220204000808000ull, 0x2860100040024022ull, 0x0001002004110040ull, 0x99101042000A0020ull,
+    0x0004080004008080ull, 0x0010040002008080ull, 0x2012004881020004ull, 0x8300842444820011ull,
+    0x0088403882010200ull, 0x0820400080210100ull, 0x0110910040A00300ull, 0x0801100280080480ull,
+    0x0242009008200600ull, 0x1002000489500200ull, 0x0040800200010080ull, 0x0091800041000080ull,
+    0x0000209300488001ull, 0x04C1002414824001ull, 0x020020000B001041ull, 0x7000100004200901ull,
+    0x8002002004100802ull, 0x30010002084C0007ull, 0x0888221800813004ull, 0x4000002840840112ull
+};
+
+constexpr Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+    0xA010041108003100ull, 0x006082020A002900ull, 0x6810010619200000ull, 0x08281A0520000408ull,
+    0x0001104001000400ull, 0x0018901008048400ull, 0x00040A0210245280ull, 0x000200210808A402ull,
+    0x9140048410821200ull, 0x0800091010820041ull, 0x20504804832202C0ull, 0x0100091401081000ull,
+    0x8021011140000012ull, 0x0810020804450400ull, 0x208B0542109008A2ull, 0x0080084A08040204ull,
+    0x0040E2A80811244Cull, 0x2505022008008108ull, 0x0430220100420040ull, 0x010A040420220040ull,
+    0x1105000290400000ull, 0x0093001200822120ull, 0x4000A62048043004ull, 0x280120048A015004ull,
+    0x006090002A020814ull, 0x44042000240800D0ull, 0x01102800040A4400ull, 0x1004080080220040ull,
+    0x0001001011004024ull, 0x0010044000805040ull, 0x0914041200820100ull, 0x0004821012821480ull,
+    0x0024040500C05021ull, 0x0088611002080200ull, 0x0116080A00040020ull, 0x4000020080080080ull,
+    0x2450450140840040ull, 0x0000880201484100ull, 0x0222020404020092ull, 0x8081110600002E00ull,
+    0x2842101105000801ull, 0x1100809008001025ull, 0x00020202221C0400ull, 0x0422014022009020ull,
+    0x0210046102100C00ull, 0xC004008082029102ull, 0x00AA461801101200ull, 0x0404080080201108ull,
+    0x020542108C205002ull, 0x0410544804100100ull, 0x0040910841100000ull, 0x0400200042021100ull,
+    0x00004204850400C0ull, 0x0200100410A42102ull, 0x1040020801210102ull, 0x0805040410420000ull,
+    0x2884804130100200ull, 0x800C262201242000ull, 0x1058000194108800ull, 0x0014221054420204ull,
+    0x0104000012A02200ull, 0x0200881003300100ull, 0x0140400202840100ull, 0x0402020801010201ull
+};
+
+constexpr int ROOK_DIRS[4][2] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+constexpr int BISHOP_DIRS[4][2] = {{1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+
+constexpr bool onBoard(int x, int y) { return x >= 0 && x < 8 && y >= 0 && y < 8; }
+
+constexpr Bitboard slideAttacks(int sq, Bitboard occupied, const int (&dirs)[4][2]) {
+    Bitboard b = 0;
+    for (int d = 0; d < 4; ++d) {
+        int x = (sq & 7) + dirs[d][0], y = (sq >> 3) + dirs[d][1];
+        while (onBoard(x, y)) {
+            Bitboard s = Bitboard(1) << (y * 8 + x);
+            b |= s;
+            if (occupied & s) break;
+            x += dirs[d][0];
+            y += dirs[d][1];
+        }
+    }
+    return b;
+}
+
+// Blockers on the last square of a ray never change the attack set.
+constexpr Bitboard relevantMask(int sq, const int (&dirs)[4][2]) {
+    Bitboard b = 0;
+    for (int d = 0; d < 4; ++d) {
+        int x = (sq & 7) + dirs[d][0], y = (sq >> 3) + dirs[d][1];
+        while (onBoard(x + dirs[d][0], y + dirs[d][1])) {
+            b |= Bitboard(1) << (y * 8 + x);
+            x += dirs[d][0];
+            y += dirs[d][1];
+        }
+    }
+    return b;
+}
+
+constexpr void fillSlider(SliderTables &t, std::array<Magic, 64> &magics, const Bitboard (&numbers)[64],
+                          const int (&dirs)[4][2], unsigned &offset) {
+    for (int sq = 0; sq < 64; ++sq) {
+        Magic &m = magics[sq];
+        m.mask = relevantMask(sq, dirs);
+        m.magic = numbers[sq];
+        m.offset = offset;
+        m.shift = 64 - __builtin_popcountll(m.mask);
+
+        // Carry-rippler enumeration visits the subsets in pext-index order.
+        Bitboard sub = 0;
+        unsigned index = 0;
+        do {
+            Bitboard attacks = slideAttacks(sq, sub, dirs);
+            Bitboard &slot = t.magicAttacks[offset + ((sub * m.magic) >> m.shift)];
+            if (slot && slot != attacks) throw "colliding magic number";
+            slot = attacks;
+            t.pextAttacks[offset + index++] = attacks;
+            sub = (sub - m.mask) & m.mask;
+        } while (sub);
+        offset += index;
+    }
+}
+
+constexpr SliderTables buildSliderTables() {
+    SliderTables t{};
+    unsigned offset = 0;
+    fillSlider(t, t.rook, ROOK_MAGIC_NUMBERS, ROOK_DIRS, offset);
+    fillSlider(t, t.bishop, BISHOP_MAGIC_NUMBERS, BISHOP_DIRS, offset);
+    if (offset != SLIDER_TABLE_SIZE) throw "slider table size mismatch";
+    return t;
+}
+
+bool detectPext() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+}
+
+extern constexpr SliderTables SLIDERS = buildSliderTables();
+
+// Both backends return identical sets, so a lookup made before this is
+// initialised simply takes the magic path.
+bool slidersUsePext = detectPext();
+
+bool cpuHasPext() {
+    static const bool supported = detectPext();
+    return supported;
+}
+
+bool setSliderBackend(SliderBackend backend) {
+    if (backend == SLIDERS_PEXT && !cpuHasPext()) return false;
+    slidersUsePext = backend == SLIDERS_PEXT;
+    return true;
+}
+
+SliderBackend sliderBackend() {
+    return slidersUsePext ? SLIDERS_PEXT : SLIDERS_MAGIC;
+}
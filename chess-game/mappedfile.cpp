@@ -0,0 +1,86 @@
+#include "mappedfile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string &path, bool randomAccess) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              randomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    length = size_t(size.QuadPart);
+    bytes = static_cast<const unsigned char *>(view);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *view = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);    // the mapping keeps the file alive
+    if (view == MAP_FAILED) return false;
+#if defined(MADV_RANDOM) && defined(MADV_SEQUENTIAL)
+    madvise(view, size_t(st.st_size), randomAccess ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+    length = size_t(st.st_size);
+    bytes = static_cast<const unsigned char *>(view);
+#endif
+    return true;
+}
+
+void MappedFile::release(size_t offset, size_t size) {
+    if (!bytes || offset >= length) return;
+    size = (std::min)(size, length - offset);
+#ifdef _WIN32
+    // Unlocking pages that are not locked takes them out of the working set.
+    VirtualUnlock(const_cast<unsigned char *>(bytes) + offset, size);
+#else
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t first = (offset + page - 1) / page * page, last = (offset + size) / page * page;
+    if (size_t(offset + size) == length) last = length;    // the tail page is only partly in the file
+    if (first < last) madvise(const_cast<unsigned char *>(bytes) + first, last - first, MADV_DONTNEED);
+#endif
+}
+
+void MappedFile::close() {
+    if (!bytes) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    munmap(const_cast<unsigned char *>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
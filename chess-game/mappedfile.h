@@ -0,0 +1,37 @@
+#ifndef CHESS_MAPPEDFILE_H
+#define CHESS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read-only. Pages are read in by the OS as they are
+// touched, so even a multi-gigabyte file costs no heap.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // randomAccess tells the OS not to read ahead; probes jump around.
+    // Without it, sequential readahead is requested instead.
+    bool open(const std::string &path, bool randomAccess = true);
+    void close();
+    // Drops the whole pages inside [offset, offset + size) from memory; they
+    // are read again if touched. Lets a single pass over a huge file keep
+    // its resident size bounded.
+    void release(size_t offset, size_t size);
+    bool isOpen() const { return bytes != nullptr; }
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "movegen.h"
+
+namespace {
+
+template <class List>
+inline void addTargets(List &list, int from, Bitboard targets) {
+    while (targets) list.add(from, popLsb(targets));
+}
+
+template <class List>
+inline void addPromotions(List &list, int from, int to) {
+    list.add(from, to, MOVE_PROMOTION, QUEEN);
+    list.add(from, to, MOVE_PROMOTION, ROOK);
+    list.add(from, to, MOVE_PROMOTION, BISHOP);
+    list.add(from, to, MOVE_PROMOTION, KNIGHT);
+}
+
+template <Color Us, class List>
+void addPawnMoves(const GameState &g, const CheckInfo &ci, GenType type, List &list) {
+    constexpr Color Them = Color(Us ^ 1);
+    constexpr int push = Us == WHITE ? -8 : 8;
+    constexpr Bitboard startRow = Us == WHITE ? ROW_2 : ROW_7;
+    constexpr Bitboard promoRow = Us == WHITE ? ROW_8 : ROW_1;
+    const Position &pos = g.pos;
+    Bitboard enemies = pos.byColor[Them];
+    Bitboard empty = ~pos.occupied;
+
+    Bitboard pawns = pos.pieces[Us][PAWN];
+    while (pawns) {
+        int from = popLsb(pawns);
+        Bitboard targets = 0;
+        if (type != GEN_QUIETS) targets |= PAWN_ATTACKS[Us][from] & enemies;
+        Bitboard one = squareBB(from + push);
+        if (one & empty) {
+            // Promotions are searched with the captures.
+            bool promotion = (one & promoRow) != 0;
+            if (type == GEN_ALL || (type == GEN_CAPTURES) == promotion) targets |= one;
+            if (type != GEN_CAPTURES && (squareBB(from) & startRow) && (squareBB(from + 2 * push) & empty))
+                targets |= squareBB(from + 2 * push);
+        }
+        targets &= ci.checkMask;
+        if (ci.pinned & squareBB(from)) targets &= LINE[ci.kingSq][from];
+
+        if (targets & promoRow) {
+            while (targets) addPromotions(list, from, popLsb(targets));
+        } else {
+            addTargets(list, from, targets);
+        }
+    }
+
+    // En passant removes two pawns from one rank, which can uncover a slider
+    // the pin mask does not see, so test the resulting occupancy directly.
+    if (g.epSquare >= 0 && type != GEN_QUIETS) {
+        int captured = g.epSquare - push;
+        Bitboard capturers = PAWN_ATTACKS[Them][g.epSquare] & pos.pieces[Us][PAWN];
+        while (capturers) {
+            int from = popLsb(capturers);
+            Bitboard occ = (pos.occupied ^ squareBB(from) ^ squareBB(captured)) | squareBB(g.epSquare);
+            if (!(pos.attackersTo<Them>(ci.kingSq, occ) & ~squareBB(captured)))
+                list.add(from, g.epSquare, MOVE_EN_PASSANT);
+        }
+    }
+}
+
+template <Color Us, class List>
+void addCastling(const GameState &g, List &list) {
+    constexpr Color Them = Color(Us ^ 1);
+    constexpr int king = Us == WHITE ? 60 : 4;
+    constexpr int shortRight = Us == WHITE ? WHITE_OO : BLACK_OO;
+    constexpr int longRight = Us == WHITE ? WHITE_OOO : BLACK_OOO;
+    const Position &pos = g.pos;
+
+    if ((g.castlingRights & shortRight) && !(pos.occupied & (squareBB(king + 1) | squareBB(king + 2)))
+        && !pos.attacked<Them>(king + 1, pos.occupied) && !pos.attacked<Them>(king + 2, pos.occupied))
+        list.add(king, king + 2, MOVE_CASTLING);
+    if ((g.castlingRights & longRight) && !(pos.occupied & (squareBB(king - 1) | squareBB(king - 2) | squareBB(king - 3)))
+        && !pos.attacked<Them>(king - 1, pos.occupied) && !pos.attacked<Them>(king - 2, pos.occupied))
+        list.add(king, king - 2, MOVE_CASTLING);
+}
+
+}
+
+template <Color Us>
+CheckInfo computeCheckInfo(const Position &pos) {
+    constexpr Color Them = Color(Us ^ 1);
+    CheckInfo ci;
+    const Bitboard *enemy = pos.pieces[Them];
+    ci.kingSq = pos.kingSquare(Us);
+    ci.checkers = pos.attackersTo<Them>(ci.kingSq, pos.occupied);
+
+    // An enemy slider on an open line to our king pins the single piece of ours between them.
+    ci.pinned = 0;
+    Bitboard snipers = (rookAttacks(ci.kingSq, 0) & (enemy[ROOK] | enemy[QUEEN]))
+                     | (bishopAttacks(ci.kingSq, 0) & (enemy[BISHOP] | enemy[QUEEN]));
+    while (snipers) {
+        Bitboard blockers = BETWEEN[ci.kingSq][popLsb(snipers)] & pos.occupied;
+        if (blockers && !(blockers & (blockers - 1))) ci.pinned |= blockers & pos.byColor[Us];
+    }
+
+    if (!ci.checkers) ci.checkMask = ~Bitboard(0);
+    else if (ci.checkers & (ci.checkers - 1)) ci.checkMask = 0;
+    else ci.checkMask = BETWEEN[ci.kingSq][lsb(ci.checkers)] | ci.checkers;
+    return ci;
+}
+
+CheckInfo computeCheckInfo(const Position &pos, Color us) {
+    return us == WHITE ? computeCheckInfo<WHITE>(pos) : computeCheckInfo<BLACK>(pos);
+}
+
+template <Color Us, class List>
+int generateLegalMoves(const GameState &g, List &list, GenType type) {
+    constexpr Color Them = Color(Us ^ 1);
+    const Position &pos = g.pos;
+    CheckInfo ci = computeCheckInfo<Us>(pos);
+    int start = list.count;
+
+    Bitboard stageMask = type == GEN_CAPTURES ? pos.byColor[Them]
+                       : type == GEN_QUIETS ? ~pos.occupied
+                       : ~pos.byColor[Us];
+
+    // The king may not step along the line of a slider it is moving away from,
+    // so test its destinations with the king itself removed.
+    Bitboard kingTargets = KING_ATTACKS[ci.kingSq] & stageMask;
+    Bitboard withoutKing = pos.occupied ^ squareBB(ci.kingSq);
+    while (kingTargets) {
+        int to = popLsb(kingTargets);
+        if (!pos.attacked<Them>(to, withoutKing)) list.add(ci.kingSq, to);
+    }
+    if (!ci.checkMask) return list.count - start;
+    if (!ci.checkers && type != GEN_CAPTURES) addCastling<Us>(g, list);
+
+    Bitboard targetMask = stageMask & ci.checkMask;
+    const Bitboard *own = pos.pieces[Us];
+
+    Bitboard knights = own[KNIGHT] & ~ci.pinned;    // a pinned knight can never move
+    while (knights) {
+        int from = popLsb(knights);
+        addTargets(list, from, KNIGHT_ATTACKS[from] & targetMask);
+    }
+
+    Bitboard diagonal = own[BISHOP] | own[QUEEN];
+    while (diagonal) {
+        int from = popLsb(diagonal);
+        Bitboard targets = bishopAttacks(from, pos.occupied) & targetMask;
+        if (ci.pinned & squareBB(from)) targets &= LINE[ci.kingSq][from];
+        addTargets(list, from, targets);
+    }
+
+    Bitboard straight = own[ROOK] | own[QUEEN];
+    while (straight) {
+        int from = popLsb(straight);
+        Bitboard targets = rookAttacks(from, pos.occupied) & targetMask;
+        if (ci.pinned & squareBB(from)) targets &= LINE[ci.kingSq][from];
+        addTargets(list, from, targets);
+    }
+
+    addPawnMoves<Us>(g, ci, type, list);
+    return list.count - start;
+}
+
+template CheckInfo computeCheckInfo<WHITE>(const Position &);
+template CheckInfo computeCheckInfo<BLACK>(const Position &);
+template int generateLegalMoves<WHITE>(const GameState &, MoveList &, GenType);
+template int generateLegalMoves<BLACK>(const GameState &, MoveList &, GenType);
+template int generateLegalMoves<WHITE>(const GameState &, PackedMoveList &, GenType);
+template int generateLegalMoves<BLACK>(const GameState &, PackedMoveList &, GenType);
+
+int generateLegalMoves(const GameState &g, Color us, MoveList &list, GenType type) {
+    return us == WHITE ? generateLegalMoves<WHITE>(g, list, type) : generateLegalMoves<BLACK>(g, list, type);
+}
+
+int generateLegalMoves(const GameState &g, Color us, PackedMoveList &list, GenType type) {
+    return us == WHITE ? generateLegalMoves<WHITE>(g, list, type) : generateLegalMoves<BLACK>(g, list, type);
+}
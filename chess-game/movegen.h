@@ -0,0 +1,63 @@
+#ifndef CHESS_MOVEGEN_H
+#define CHESS_MOVEGEN_H
+
+#include "rules.h"
+
+const int MAX_MOVES = 256;    // no legal position has more than 218
+
+// Fixed-capacity move list; lives on the caller's stack, never allocates.
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+
+    void add(int from, int to, MoveKind kind = MOVE_NORMAL, PieceType promotion = NO_PIECE_TYPE) {
+        Move &m = moves[count++];
+        m.sx = squareX(from); m.sy = squareY(from);
+        m.tx = squareX(to); m.ty = squareY(to);
+        m.kind = kind;
+        m.promotion = promotion;
+    }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move *begin() { return moves; }
+    Move *end() { return moves + count; }
+    const Move *begin() const { return moves; }
+    const Move *end() const { return moves + count; }
+};
+
+// The same list at 16 bits a move, for the search, which keeps one per ply
+// and unpacks a move only when it gets to it.
+struct PackedMoveList {
+    PackedMove moves[MAX_MOVES];
+    int count = 0;
+
+    void add(int from, int to, MoveKind kind = MOVE_NORMAL, PieceType promotion = NO_PIECE_TYPE) {
+        moves[count++] = packMove(from, to, kind, promotion);
+    }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+// Stages let a search look at captures and promotions before quiet moves;
+// castling is a quiet move.
+enum GenType { GEN_CAPTURES, GEN_QUIETS, GEN_ALL };
+
+// Check and pin information for one side, computed once per position.
+struct CheckInfo {
+    Bitboard checkers;
+    Bitboard pinned;
+    Bitboard checkMask;    // destinations that resolve a single check (all squares if none)
+    int kingSq;
+};
+
+CheckInfo computeCheckInfo(const Position &pos, Color us);
+int generateLegalMoves(const GameState &g, Color us, MoveList &list, GenType type = GEN_ALL);
+int generateLegalMoves(const GameState &g, Color us, PackedMoveList &list, GenType type = GEN_ALL);
+
+// Specialized on the side to move, so the generator carries no color
+// branches; the overloads above pick one of these. List is MoveList or
+// PackedMoveList.
+template <Color Us> CheckInfo computeCheckInfo(const Position &pos);
+template <Color Us, class List> int generateLegalMoves(const GameState &g, List &list, GenType type = GEN_ALL);
+
+#endif
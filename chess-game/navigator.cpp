@@ -0,0 +1,218 @@
+#include "navigator.h"
+
+#include <algorithm>
+
+namespace {
+
+const int FIFTY_MOVE_PLIES = 100;
+
+}
+
+GameNavigator::GameNavigator(int keyframeInterval) : interval(std::max(1, keyframeInterval)) {
+    reset();
+}
+
+void GameNavigator::reset() {
+    GameState start;
+    initBoard(start);
+    reset(start);
+}
+
+void GameNavigator::reset(const GameState &start) {
+    g = start;
+    setNnue(g, nullptr);
+    g.moveStack.clear();
+    g.keys.clear();
+    nodes.assign(1, Node());
+    keyframes.clear();
+    nodes[ROOT].hash = g.hash;
+    addKeyframe(nodes[ROOT]);
+    cur = ROOT;
+    replayed = 0;
+    arrive();
+}
+
+void GameNavigator::addKeyframe(Node &node) {
+    Keyframe k;
+    packGame(g, k.game);
+    k.game.status = GAME_ONGOING;
+    k.halfmoveClock = g.halfmoveClock;
+    k.whiteCaptures = g.whiteCaptures;
+    k.blackCaptures = g.blackCaptures;
+    node.keyframe = int32_t(keyframes.size());
+    keyframes.push_back(k);
+}
+
+GameNavigator::NodeId GameNavigator::play(const Move &m) {
+    PackedMove pm = packMove(m);
+    NodeId last = NONE;
+    for (NodeId c = nodes[cur].firstChild; c != NONE; c = nodes[c].nextSibling) {
+        if (nodes[c].move == pm) {
+            makeMove(g, m);
+            cur = c;
+            arrive();
+            return c;
+        }
+        last = c;
+    }
+    Node node;
+    node.parent = cur;
+    node.ply = nodes[cur].ply + 1;
+    node.move = pm;
+    node.san = moveToSan(g, m);
+    makeMove(g, m);
+    node.hash = g.hash;
+    if (node.ply % interval == 0) addKeyframe(node);
+    NodeId id = NodeId(nodes.size());
+    if (last == NONE) nodes[cur].firstChild = id;
+    else nodes[last].nextSibling = id;
+    nodes.push_back(std::move(node));
+    cur = id;
+    arrive();
+    return id;
+}
+
+bool GameNavigator::back() {
+    if (cur == ROOT) return false;
+    if (g.moveStack.empty()) {
+        jump(nodes[cur].parent);
+        return true;
+    }
+    undoMove(g);
+    ++replayed;
+    cur = nodes[cur].parent;
+    arrive();
+    return true;
+}
+
+bool GameNavigator::forward() {
+    NodeId next = nodes[cur].firstChild;
+    if (next == NONE) return false;
+    makeMove(g, unpackMove(nodes[next].move));
+    ++replayed;
+    cur = next;
+    arrive();
+    return true;
+}
+
+// Sets g to a keyframe node's position. The keys the repetition rule looks
+// at, those back to the last irreversible move, come from the ancestors;
+// no more than a hundred, as the fifty-move rule has drawn the game by then.
+void GameNavigator::restore(NodeId node) {
+    const Keyframe &k = keyframes[nodes[node].keyframe];
+    unpackGame(k.game, g);
+    g.halfmoveClock = k.halfmoveClock;
+    g.whiteCaptures = k.whiteCaptures;
+    g.blackCaptures = k.blackCaptures;
+    int n = std::min(std::min(g.halfmoveClock, FIFTY_MOVE_PLIES), nodes[node].ply);
+    g.keys.resize(n);
+    for (int i = n - 1; i >= 0; --i) {
+        node = nodes[node].parent;
+        g.keys[i] = nodes[node].hash;
+    }
+}
+
+void GameNavigator::jump(NodeId target) {
+    if (target == cur) return;
+    NodeId key = target;
+    int restoreCost = 0;
+    while (nodes[key].keyframe < 0) {
+        key = nodes[key].parent;
+        ++restoreCost;
+    }
+    // Through the common ancestor with the current node instead, if that
+    // is no more work and the moves to undo are still on the stack.
+    NodeId a = cur, b = target;
+    int up = 0, down = 0;
+    while (a != b && up + down <= restoreCost) {
+        if (nodes[a].ply >= nodes[b].ply) {
+            a = nodes[a].parent;
+            ++up;
+        } else {
+            b = nodes[b].parent;
+            ++down;
+        }
+    }
+    NodeId from;
+    if (a == b && up + down <= restoreCost && size_t(up) <= g.moveStack.size()) {
+        for (int i = 0; i < up; ++i) undoMove(g);
+        replayed += up;
+        from = a;
+    } else {
+        restore(key);
+        from = key;
+    }
+    path.clear();
+    for (NodeId n = target; n != from; n = nodes[n].parent) path.push_back(n);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) makeMove(g, unpackMove(nodes[*it].move));
+    replayed += path.size();
+    cur = target;
+    arrive();
+}
+
+bool GameNavigator::jumpToPly(int ply) {
+    if (ply < 0) return false;
+    NodeId n = cur;
+    while (nodes[n].ply > ply) n = nodes[n].parent;
+    while (nodes[n].ply < ply) {
+        n = nodes[n].firstChild;
+        if (n == NONE) return false;
+    }
+    jump(n);
+    return true;
+}
+
+void GameNavigator::remove(NodeId node) {
+    if (node == ROOT) return;
+    NodeId p = nodes[node].parent;
+    NodeId *link = &nodes[p].firstChild;
+    while (*link != node) link = &nodes[*link].nextSibling;
+    *link = nodes[node].nextSibling;
+    nodes[node].nextSibling = NONE;
+    NodeId n = cur;
+    while (nodes[n].ply > nodes[node].ply) n = nodes[n].parent;
+    if (n == node) jump(p);
+}
+
+void GameNavigator::promote(NodeId node) {
+    for (; node != ROOT; node = nodes[node].parent) {
+        NodeId p = nodes[node].parent;
+        if (nodes[p].firstChild == node) continue;
+        NodeId prev = nodes[p].firstChild;
+        while (nodes[prev].nextSibling != node) prev = nodes[prev].nextSibling;
+        nodes[prev].nextSibling = nodes[node].nextSibling;
+        nodes[node].nextSibling = nodes[p].firstChild;
+        nodes[p].firstChild = node;
+    }
+}
+
+std::vector<GameNavigator::NodeId> GameNavigator::line() const {
+    std::vector<NodeId> out(nodes[cur].ply);
+    NodeId n = cur;
+    for (int i = nodes[cur].ply - 1; i >= 0; --i, n = nodes[n].parent) out[i] = n;
+    for (n = nodes[cur].firstChild; n != NONE; n = nodes[n].firstChild) out.push_back(n);
+    return out;
+}
+
+std::vector<GameNavigator::NodeId> GameNavigator::children(NodeId node) const {
+    std::vector<NodeId> out;
+    for (NodeId c = nodes[node].firstChild; c != NONE; c = nodes[c].nextSibling) out.push_back(c);
+    return out;
+}
+
+// The fields that belong to the node rather than to the moves made to
+// reach it. undoMove takes the last move from the stack, which after a
+// restore may not reach back to the node's move.
+void GameNavigator::arrive() {
+    g.gameOver = false;
+    g.gameResult.clear();
+    if (cur == ROOT) {
+        g.lastMoveFromX = g.lastMoveFromY = g.lastMoveToX = g.lastMoveToY = -1;
+        return;
+    }
+    Move m = unpackMove(nodes[cur].move);
+    g.lastMoveFromX = m.sx;
+    g.lastMoveFromY = m.sy;
+    g.lastMoveToX = m.tx;
+    g.lastMoveToY = m.ty;
+}
@@ -0,0 +1,106 @@
+#ifndef CHESS_NAVIGATOR_H
+#define CHESS_NAVIGATOR_H
+
+#include "session.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A game and its variations as a tree of moves, with the position at any
+// node a short replay away.
+//
+// Node 0 is the starting position and every other node the position after
+// its move. A node's first child continues the main line; later children
+// are variations. Each node at a ply divisible by the keyframe interval
+// keeps a CompactGame snapshot, so reaching any node replays fewer moves
+// than the interval from the nearest keyframe above it. Reaching a nearby
+// node (a step back or forward, or into a sibling variation) instead
+// undoes and makes the few moves in between. A jump never costs more than
+// the interval, however long the game.
+class GameNavigator {
+public:
+    typedef uint32_t NodeId;
+    static const NodeId ROOT = 0;
+    static const int DEFAULT_KEYFRAME_INTERVAL = 16;
+
+    explicit GameNavigator(int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    // Starts a new tree at initBoard's position, or at start.
+    void reset();
+    void reset(const GameState &start);
+
+    // The position at the current node. The UI may set its selection and
+    // game-over fields, but moves go through play() and the navigation
+    // calls. Every move there clears gameOver, as undoMove does, so the
+    // caller runs checkGameEnd for the node it arrives at. Positions have
+    // no NNUE network attached.
+    GameState &position() { return g; }
+    const GameState &position() const { return g; }
+    NodeId current() const { return cur; }
+    int ply() const { return nodes[cur].ply; }
+
+    // Plays m, which must be legal here. Follows the child with that move
+    // if there is one; otherwise adds a child, which becomes a variation
+    // if the node already has a continuation.
+    NodeId play(const Move &m);
+    bool back();       // to the parent; false at the root
+    bool forward();    // along the main line; false at its end
+    void jump(NodeId node);
+    // Within the current line (see line()); false past its end.
+    bool jumpToPly(int ply);
+    // Detaches node, which must not be the root, and everything after it.
+    // The current node moves to node's parent if it was among them. The
+    // nodes' memory is kept until reset().
+    void remove(NodeId node);
+    // Makes node's line the main line at each branch on the way to it.
+    void promote(NodeId node);
+
+    // The current line, one node per ply from the first move: the current
+    // node's ancestors, the node itself, then its main line to the end.
+    std::vector<NodeId> line() const;
+    NodeId parent(NodeId node) const { return nodes[node].parent; }
+    std::vector<NodeId> children(NodeId node) const;
+    int plyOf(NodeId node) const { return nodes[node].ply; }
+    PackedMove move(NodeId node) const { return nodes[node].move; }
+    const std::string &san(NodeId node) const { return nodes[node].san; }
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t keyframeCount() const { return keyframes.size(); }
+    // makeMove and undoMove calls spent on navigation, play() excluded.
+    uint64_t replayedMoves() const { return replayed; }
+
+private:
+    static const NodeId NONE = UINT32_MAX;
+
+    struct Node {
+        NodeId parent = NONE;
+        NodeId firstChild = NONE;
+        NodeId nextSibling = NONE;
+        int32_t keyframe = -1;    // index into keyframes, for every interval-th ply
+        int ply = 0;
+        PackedMove move = 0;
+        uint64_t hash = 0;        // of the position at the node, for rebuilding g.keys
+        std::string san;
+    };
+
+    struct Keyframe {
+        CompactGame game;
+        int halfmoveClock;    // CompactGame's saturates at 255
+        int whiteCaptures, blackCaptures;
+    };
+
+    void addKeyframe(Node &node);
+    void restore(NodeId node);
+    void arrive();
+
+    int interval;
+    std::vector<Node> nodes;
+    std::vector<Keyframe> keyframes;
+    std::vector<NodeId> path;    // scratch for jump()
+    GameState g;
+    NodeId cur = ROOT;
+    uint64_t replayed = 0;
+};
+
+#endif
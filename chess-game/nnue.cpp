@@ -0,0 +1,422 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char NNUE_MAGIC[4] = {'C', 'G', 'N', 'N'};
+const uint32_t NNUE_VERSION = 1;
+
+// Fixed-point scales: first-layer activations run 0..127 for 0..1, the
+// hidden weights are in 64ths, so a hidden sum shifted right by 6 is back
+// on the activation scale.
+const int ACTIVATION_SCALE = 127;
+const int WEIGHT_SCALE = 64;
+const int WEIGHT_SHIFT = 6;
+const int OUTPUT_SCALE = ACTIVATION_SCALE * WEIGHT_SCALE;
+const int MAX_SCORE = 10000;    // well clear of mate and tablebase scores
+
+const int FT_WEIGHT_COUNT = NNUE_FEATURES * NNUE_HIDDEN;
+const int L1_WEIGHT_COUNT = NNUE_L1 * 2 * NNUE_HIDDEN;
+
+// Features are relative to the perspective: its own pieces first, squares
+// flipped for black so both sides see their pieces from their own rank 1.
+inline int featureIndex(Color perspective, Color c, PieceType t, int sq) {
+    int relative = c == perspective ? 0 : 1;
+    int oriented = perspective == WHITE ? sq : sq ^ 56;
+    return (relative * 6 + t) * 64 + oriented;
+}
+
+inline int featureIndex(Color perspective, char p, int sq) {
+    return featureIndex(perspective, pieceColor(p), pieceTypeOf(p), sq);
+}
+
+template <typename T>
+T quantized(float value, float scale, int lo, int hi) {
+    return T(std::max<long>(lo, std::min<long>(hi, std::lround(value * scale))));
+}
+
+// ---- Kernels ---------------------------------------------------------------
+//
+// rows:      out = src + sum(add rows) - sum(sub rows), one perspective wide
+// transform: clamp both perspectives to 0..127 and pack to bytes, us first
+// hidden:    out[o] = sum(input[i] * weights[o][i]) for every hidden neuron
+//
+// The SIMD versions use only exact integer operations (wrapping 16-bit adds,
+// and u8 * s8 pairs that cannot saturate with weights within +-127), so they
+// agree with the scalar ones bit for bit.
+
+void rowsScalar(int16_t *out, const int16_t *src, const int16_t *const *add, int addCount,
+                const int16_t *const *sub, int subCount) {
+    for (int i = 0; i < NNUE_HIDDEN; ++i) {
+        int v = src[i];
+        for (int k = 0; k < addCount; ++k) v += add[k][i];
+        for (int k = 0; k < subCount; ++k) v -= sub[k][i];
+        out[i] = int16_t(v);
+    }
+}
+
+void transformScalar(const int16_t *us, const int16_t *them, uint8_t *out) {
+    for (int i = 0; i < NNUE_HIDDEN; ++i) {
+        out[i] = uint8_t(std::max(0, std::min(ACTIVATION_SCALE, int(us[i]))));
+        out[NNUE_HIDDEN + i] = uint8_t(std::max(0, std::min(ACTIVATION_SCALE, int(them[i]))));
+    }
+}
+
+void hiddenScalar(const uint8_t *input, const int8_t *weights, int32_t *out) {
+    for (int o = 0; o < NNUE_L1; ++o) {
+        const int8_t *w = weights + o * 2 * NNUE_HIDDEN;
+        int32_t sum = 0;
+        for (int i = 0; i < 2 * NNUE_HIDDEN; ++i) sum += int32_t(input[i]) * w[i];
+        out[o] = sum;
+    }
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("sse4.1")))
+void rowsSse41(int16_t *out, const int16_t *src, const int16_t *const *add, int addCount,
+               const int16_t *const *sub, int subCount) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        for (int k = 0; k < addCount; ++k) v = _mm_add_epi16(v, _mm_loadu_si128((const __m128i *)(add[k] + i)));
+        for (int k = 0; k < subCount; ++k) v = _mm_sub_epi16(v, _mm_loadu_si128((const __m128i *)(sub[k] + i)));
+        _mm_storeu_si128((__m128i *)(out + i), v);
+    }
+}
+
+__attribute__((target("sse4.1")))
+void transformSse41(const int16_t *us, const int16_t *them, uint8_t *out) {
+    const __m128i zero = _mm_setzero_si128(), top = _mm_set1_epi16(ACTIVATION_SCALE);
+    const int16_t *halves[2] = {us, them};
+    for (int h = 0; h < 2; ++h)
+        for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(halves[h] + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(halves[h] + i + 8));
+            a = _mm_min_epi16(_mm_max_epi16(a, zero), top);
+            b = _mm_min_epi16(_mm_max_epi16(b, zero), top);
+            _mm_storeu_si128((__m128i *)(out + h * NNUE_HIDDEN + i), _mm_packus_epi16(a, b));
+        }
+}
+
+__attribute__((target("sse4.1")))
+void hiddenSse41(const uint8_t *input, const int8_t *weights, int32_t *out) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int o = 0; o < NNUE_L1; ++o) {
+        const int8_t *w = weights + o * 2 * NNUE_HIDDEN;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16) {
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(input + i)),
+                                                 _mm_loadu_si128((const __m128i *)(w + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[o] = _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2")))
+void rowsAvx2(int16_t *out, const int16_t *src, const int16_t *const *add, int addCount,
+              const int16_t *const *sub, int subCount) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        for (int k = 0; k < addCount; ++k)
+            v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i *)(add[k] + i)));
+        for (int k = 0; k < subCount; ++k)
+            v = _mm256_sub_epi16(v, _mm256_loadu_si256((const __m256i *)(sub[k] + i)));
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    }
+}
+
+__attribute__((target("avx2")))
+void transformAvx2(const int16_t *us, const int16_t *them, uint8_t *out) {
+    const __m256i zero = _mm256_setzero_si256(), top = _mm256_set1_epi16(ACTIVATION_SCALE);
+    const int16_t *halves[2] = {us, them};
+    for (int h = 0; h < 2; ++h)
+        for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(halves[h] + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(halves[h] + i + 16));
+            a = _mm256_min_epi16(_mm256_max_epi16(a, zero), top);
+            b = _mm256_min_epi16(_mm256_max_epi16(b, zero), top);
+            // packus works within 128-bit lanes; put the quarters back in order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256((__m256i *)(out + h * NNUE_HIDDEN + i), packed);
+        }
+}
+
+__attribute__((target("avx2")))
+void hiddenAvx2(const uint8_t *input, const int8_t *weights, int32_t *out) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int o = 0; o < NNUE_L1; ++o) {
+        const int8_t *w = weights + o * 2 * NNUE_HIDDEN;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 32) {
+            __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(input + i)),
+                                                    _mm256_loadu_si256((const __m256i *)(w + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        out[o] = _mm_cvtsi128_si32(s);
+    }
+}
+
+#endif
+
+bool detectBackend(NnueBackend backend) {
+    if (backend == NNUE_SCALAR) return true;
+#ifdef NNUE_X86
+    __builtin_cpu_init();
+    if (backend == NNUE_SSE41) return __builtin_cpu_supports("sse4.1");
+    if (backend == NNUE_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+    return false;
+}
+
+NnueBackend bestBackend() {
+    if (detectBackend(NNUE_AVX2)) return NNUE_AVX2;
+    if (detectBackend(NNUE_SSE41)) return NNUE_SSE41;
+    return NNUE_SCALAR;
+}
+
+NnueBackend activeBackend = bestBackend();
+
+void rows(int16_t *out, const int16_t *src, const int16_t *const *add, int addCount,
+          const int16_t *const *sub, int subCount) {
+#ifdef NNUE_X86
+    if (activeBackend == NNUE_AVX2) return rowsAvx2(out, src, add, addCount, sub, subCount);
+    if (activeBackend == NNUE_SSE41) return rowsSse41(out, src, add, addCount, sub, subCount);
+#endif
+    rowsScalar(out, src, add, addCount, sub, subCount);
+}
+
+void transform(const int16_t *us, const int16_t *them, uint8_t *out) {
+#ifdef NNUE_X86
+    if (activeBackend == NNUE_AVX2) return transformAvx2(us, them, out);
+    if (activeBackend == NNUE_SSE41) return transformSse41(us, them, out);
+#endif
+    transformScalar(us, them, out);
+}
+
+void hidden(const uint8_t *input, const int8_t *weights, int32_t *out) {
+#ifdef NNUE_X86
+    if (activeBackend == NNUE_AVX2) return hiddenAvx2(input, weights, out);
+    if (activeBackend == NNUE_SSE41) return hiddenSse41(input, weights, out);
+#endif
+    hiddenScalar(input, weights, out);
+}
+
+// ---- File format -------------------------------------------------------------
+//
+// "CGNN", then version, features, hidden and l1 sizes as little-endian
+// uint32, then little-endian float32 arrays: first-layer weights
+// [feature][hidden] and biases, hidden weights [l1][2 * hidden] and biases,
+// output weights [l1] and bias.
+
+bool readU32(std::istream &in, uint32_t &v) {
+    unsigned char b[4];
+    if (!in.read((char *)b, 4)) return false;
+    v = uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+    return true;
+}
+
+void writeU32(std::ostream &out, uint32_t v) {
+    unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16),
+                          (unsigned char)(v >> 24)};
+    out.write((const char *)b, 4);
+}
+
+bool readFloats(std::istream &in, std::vector<float> &values, size_t count) {
+    values.resize(count);
+    for (float &f : values) {
+        uint32_t bits;
+        if (!readU32(in, bits)) return false;
+        std::memcpy(&f, &bits, 4);
+    }
+    return true;
+}
+
+void writeFloats(std::ostream &out, const std::vector<float> &values) {
+    for (float f : values) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, 4);
+        writeU32(out, bits);
+    }
+}
+
+}
+
+bool nnueBackendSupported(NnueBackend backend) {
+    static const bool supported[3] = {true, detectBackend(NNUE_SSE41), detectBackend(NNUE_AVX2)};
+    return supported[backend];
+}
+
+bool setNnueBackend(NnueBackend backend) {
+    if (!nnueBackendSupported(backend)) return false;
+    activeBackend = backend;
+    return true;
+}
+
+NnueBackend nnueBackend() { return activeBackend; }
+
+const char *nnueBackendName(NnueBackend backend) {
+    switch (backend) {
+        case NNUE_AVX2: return "avx2";
+        case NNUE_SSE41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+bool NnueNetwork::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t version, features, hiddenSize, l1Size;
+    if (!in.read(magic, 4) || std::memcmp(magic, NNUE_MAGIC, 4) != 0) return false;
+    if (!readU32(in, version) || !readU32(in, features) || !readU32(in, hiddenSize) || !readU32(in, l1Size))
+        return false;
+    if (version != NNUE_VERSION || features != NNUE_FEATURES || hiddenSize != NNUE_HIDDEN || l1Size != NNUE_L1)
+        return false;
+
+    NnueNetwork net;
+    std::vector<float> outBias;
+    if (!readFloats(in, net.ftWeightsF, FT_WEIGHT_COUNT) || !readFloats(in, net.ftBiasF, NNUE_HIDDEN)
+        || !readFloats(in, net.l1WeightsF, L1_WEIGHT_COUNT) || !readFloats(in, net.l1BiasF, NNUE_L1)
+        || !readFloats(in, net.outWeightsF, NNUE_L1) || !readFloats(in, outBias, 1))
+        return false;
+    if (in.peek() != std::char_traits<char>::eof()) return false;
+    net.outBiasF = outBias[0];
+    net.quantize();
+    *this = std::move(net);
+    return true;
+}
+
+bool NnueNetwork::save(const std::string &path) const {
+    if (!isLoaded()) return false;
+    std::ofstream out(path, std::ios::binary);
+    out.write(NNUE_MAGIC, 4);
+    writeU32(out, NNUE_VERSION);
+    writeU32(out, NNUE_FEATURES);
+    writeU32(out, NNUE_HIDDEN);
+    writeU32(out, NNUE_L1);
+    writeFloats(out, ftWeightsF);
+    writeFloats(out, ftBiasF);
+    writeFloats(out, l1WeightsF);
+    writeFloats(out, l1BiasF);
+    writeFloats(out, outWeightsF);
+    writeFloats(out, std::vector<float>{outBiasF});
+    return bool(out);
+}
+
+// Small weights, so that with a full board most first-layer neurons sit
+// inside the clipped range rather than pinned at either end.
+void NnueNetwork::randomize(uint64_t seed) {
+    std::mt19937_64 random(seed);
+    auto fill = [&](std::vector<float> &values, size_t count, float lo, float hi) {
+        std::uniform_real_distribution<float> dist(lo, hi);
+        values.resize(count);
+        for (float &v : values) v = dist(random);
+    };
+    fill(ftWeightsF, FT_WEIGHT_COUNT, -0.08f, 0.08f);
+    fill(ftBiasF, NNUE_HIDDEN, 0.2f, 0.6f);
+    fill(l1WeightsF, L1_WEIGHT_COUNT, -0.15f, 0.15f);
+    fill(l1BiasF, NNUE_L1, -0.5f, 0.5f);
+    fill(outWeightsF, NNUE_L1, -1.5f, 1.5f);
+    outBiasF = 0;
+    quantize();
+}
+
+void NnueNetwork::quantize() {
+    ftWeights.resize(FT_WEIGHT_COUNT);
+    ftBias.resize(NNUE_HIDDEN);
+    l1Weights.resize(L1_WEIGHT_COUNT);
+    l1Bias.resize(NNUE_L1);
+    outWeights.resize(NNUE_L1);
+    for (int i = 0; i < FT_WEIGHT_COUNT; ++i)
+        ftWeights[i] = quantized<int16_t>(ftWeightsF[i], ACTIVATION_SCALE, -32767, 32767);
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        ftBias[i] = quantized<int16_t>(ftBiasF[i], ACTIVATION_SCALE, -32767, 32767);
+    for (int i = 0; i < L1_WEIGHT_COUNT; ++i) l1Weights[i] = quantized<int8_t>(l1WeightsF[i], WEIGHT_SCALE, -127, 127);
+    for (int i = 0; i < NNUE_L1; ++i) {
+        l1Bias[i] = quantized<int32_t>(l1BiasF[i], OUTPUT_SCALE, -(1 << 30), 1 << 30);
+        outWeights[i] = quantized<int16_t>(outWeightsF[i], WEIGHT_SCALE, -32767, 32767);
+    }
+    outBias = quantized<int32_t>(outBiasF, OUTPUT_SCALE, -(1 << 30), 1 << 30);
+}
+
+void NnueNetwork::refresh(const Position &pos, NnueAccumulator &acc) const {
+    for (int perspective = WHITE; perspective <= BLACK; ++perspective) {
+        const int16_t *active[32];
+        int count = 0;
+        for (int c = WHITE; c <= BLACK; ++c)
+            for (int t = PAWN; t <= KING; ++t)
+                for (Bitboard b = pos.pieces[c][t]; b && count < 32; b &= b - 1) {
+                    int f = featureIndex(Color(perspective), Color(c), PieceType(t), lsb(b));
+                    active[count++] = &ftWeights[f * NNUE_HIDDEN];
+                }
+        rows(acc.values[perspective], ftBias.data(), active, count, nullptr, 0);
+    }
+}
+
+void NnueNetwork::update(const NnueAccumulator &prev, const NnueDelta &delta, NnueAccumulator &out) const {
+    for (int perspective = WHITE; perspective <= BLACK; ++perspective) {
+        const int16_t *add[2], *sub[2];
+        for (int k = 0; k < delta.addedCount; ++k)
+            add[k] = &ftWeights[featureIndex(Color(perspective), delta.added[k].piece, delta.added[k].sq) * NNUE_HIDDEN];
+        for (int k = 0; k < delta.removedCount; ++k)
+            sub[k] = &ftWeights[featureIndex(Color(perspective), delta.removed[k].piece, delta.removed[k].sq)
+                                * NNUE_HIDDEN];
+        rows(out.values[perspective], prev.values[perspective], add, delta.addedCount, sub, delta.removedCount);
+    }
+}
+
+int NnueNetwork::evaluate(const NnueAccumulator &acc, Color stm) const {
+    alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+    int32_t sums[NNUE_L1];
+    transform(acc.values[stm], acc.values[stm ^ 1], input);
+    hidden(input, l1Weights.data(), sums);
+    int32_t output = outBias;
+    for (int o = 0; o < NNUE_L1; ++o) {
+        int activation = std::max(0, std::min(ACTIVATION_SCALE, (sums[o] + l1Bias[o]) >> WEIGHT_SHIFT));
+        output += activation * outWeights[o];
+    }
+    int score = int(int64_t(output) * 100 / OUTPUT_SCALE);
+    return std::max(-MAX_SCORE, std::min(MAX_SCORE, score));
+}
+
+double NnueNetwork::evaluateFloat(const Position &pos, Color stm) const {
+    float acc[2][NNUE_HIDDEN];
+    for (int perspective = WHITE; perspective <= BLACK; ++perspective) {
+        std::copy(ftBiasF.begin(), ftBiasF.end(), acc[perspective]);
+        for (int c = WHITE; c <= BLACK; ++c)
+            for (int t = PAWN; t <= KING; ++t)
+                for (Bitboard b = pos.pieces[c][t]; b; b &= b - 1) {
+                    const float *w = &ftWeightsF[featureIndex(Color(perspective), Color(c), PieceType(t), lsb(b))
+                                                 * NNUE_HIDDEN];
+                    for (int i = 0; i < NNUE_HIDDEN; ++i) acc[perspective][i] += w[i];
+                }
+    }
+    float input[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; ++i) {
+        input[i] = std::max(0.0f, std::min(1.0f, acc[stm][i]));
+        input[NNUE_HIDDEN + i] = std::max(0.0f, std::min(1.0f, acc[stm ^ 1][i]));
+    }
+    double output = outBiasF;
+    for (int o = 0; o < NNUE_L1; ++o) {
+        const float *w = &l1WeightsF[o * 2 * NNUE_HIDDEN];
+        double sum = l1BiasF[o];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; ++i) sum += input[i] * w[i];
+        output += std::max(0.0, std::min(1.0, sum)) * outWeightsF[o];
+    }
+    return std::max(double(-MAX_SCORE), std::min(double(MAX_SCORE), output * 100));
+}
@@ -0,0 +1,77 @@
+#ifndef CHESS_NNUE_H
+#define CHESS_NNUE_H
+
+#include "bitboard.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small efficiently-updatable network: every (piece, square) pair seen
+// from each side feeds a 256-wide first layer, whose two halves (side to
+// move first) go through a 32-wide hidden layer to a single output.
+const int NNUE_FEATURES = 768;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L1 = 32;
+
+// The integer kernels. All three produce bit-identical results; the best
+// one the CPU supports is picked at startup.
+enum NnueBackend { NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2 };
+
+bool nnueBackendSupported(NnueBackend backend);
+bool setNnueBackend(NnueBackend backend);    // false if the CPU lacks it
+NnueBackend nnueBackend();
+const char *nnueBackendName(NnueBackend backend);
+
+// First-layer sums for both perspectives, white's first.
+struct NnueAccumulator {
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+};
+
+// The pieces one move takes off and puts on squares.
+struct NnueDelta {
+    struct Change {
+        char piece;
+        int sq;
+    };
+    Change removed[2];
+    Change added[2];
+    int removedCount = 0;
+    int addedCount = 0;
+
+    void remove(char p, int sq) { removed[removedCount++] = Change{p, sq}; }
+    void add(char p, int sq) { added[addedCount++] = Change{p, sq}; }
+};
+
+// Weights are stored as floats and quantized on load: the first layer to
+// int16 (activations 0..127), the hidden layer to int8, the output to int16.
+// The float weights are kept for evaluateFloat(), the reference the
+// quantized path approximates.
+class NnueNetwork {
+public:
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+    void randomize(uint64_t seed);    // for benchmarks and tests without a trained file
+    bool isLoaded() const { return !ftWeights.empty(); }
+
+    void refresh(const Position &pos, NnueAccumulator &acc) const;
+    void update(const NnueAccumulator &prev, const NnueDelta &delta, NnueAccumulator &out) const;
+    // Centipawns from the point of view of stm.
+    int evaluate(const NnueAccumulator &acc, Color stm) const;
+    double evaluateFloat(const Position &pos, Color stm) const;
+
+private:
+    void quantize();
+
+    std::vector<float> ftWeightsF, ftBiasF, l1WeightsF, l1BiasF, outWeightsF;
+    float outBiasF = 0;
+
+    std::vector<int16_t> ftWeights;    // [feature][hidden]
+    std::vector<int16_t> ftBias;
+    std::vector<int8_t> l1Weights;     // [l1][2 * hidden]
+    std::vector<int32_t> l1Bias;
+    std::vector<int16_t> outWeights;
+    int32_t outBias = 0;
+};
+
+#endif
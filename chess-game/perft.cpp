@@ -0,0 +1,107 @@
+#include "perft.h"
+#include "movegen.h"
+#include "search.h"
+
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+// The side to move alternates with depth, so after the first dispatch the
+// whole tree runs on color-specialized generation and make/unmake.
+template <Color Us>
+uint64_t perftFor(GameState &g, int depth) {
+    MoveList list;
+    generateLegalMoves<Us>(g, list);
+    if (depth == 1) return list.size();
+    uint64_t nodes = 0;
+    for (const Move &m : list) {
+        makeMove<Us>(g, m);
+        nodes += perftFor<Color(Us ^ 1)>(g, depth - 1);
+        undoMove<Us>(g);
+    }
+    return nodes;
+}
+
+}
+
+uint64_t perft(GameState &g, int depth) {
+    if (depth <= 0) return 1;
+    return g.whiteTurn ? perftFor<WHITE>(g, depth) : perftFor<BLACK>(g, depth);
+}
+
+uint64_t perftHashed(GameState &g, int depth, TranspositionTable &tt, TTStats *stats) {
+    if (depth <= 0) return 1;
+    TTData hit;
+    if (depth >= 2 && tt.probe(g.hash, hit, stats) && hit.depth == depth) return hit.payload;
+    MoveList list;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+    if (depth == 1) return list.size();
+
+    uint64_t nodes = 0;
+    for (const Move &m : list) {
+        makeMove(g, m);
+        nodes += perftHashed(g, depth - 1, tt, stats);
+        undoMove(g);
+    }
+    if (nodes <= TT_PAYLOAD_MAX) tt.store(g.hash, nodes, depth, BOUND_EXACT);
+    return nodes;
+}
+
+std::vector<std::pair<Move, uint64_t>> perftDivide(GameState &g, int depth) {
+    std::vector<std::pair<Move, uint64_t>> result;
+    if (depth <= 0) return result;
+    MoveList list;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+    for (const Move &m : list) {
+        makeMove(g, m);
+        result.push_back(std::make_pair(m, perft(g, depth - 1)));
+        undoMove(g);
+    }
+    return result;
+}
+
+// Reference positions from the Chess Programming Wiki "Perft Results" page.
+const std::vector<PerftCase> &perftSuite() {
+    static const std::vector<PerftCase> suite = {
+        {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+         {20, 400, 8902, 197281, 4865609, 119060324}},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+         {48, 2039, 97862, 4085603, 193690690}},
+        {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+         {14, 191, 2812, 43238, 674624, 11030083}},
+        {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+         {6, 264, 9467, 422333, 15833292}},
+        {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+         {44, 1486, 62379, 2103487, 89941194}},
+        {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+         {46, 2079, 89890, 3894594, 164075551}},
+    };
+    return suite;
+}
+
+// Parses "<fen> ;D1 20 ;D2 400 ..." as used by the usual perft EPD suites.
+// Depths run from 1 to MAX_PLY; anything else in a field fails the line.
+bool parseEpdLine(const std::string &line, PerftCase &out) {
+    size_t semi = line.find(';');
+    if (semi == std::string::npos) return false;
+    out.fen = line.substr(0, semi);
+    out.name = out.fen.substr(0, out.fen.find(' '));
+    out.nodes.clear();
+
+    std::istringstream in(line.substr(semi));
+    std::string field;
+    while (std::getline(in, field, ';')) {
+        std::istringstream f(field);
+        std::string tag;
+        uint64_t count;
+        if (!(f >> tag)) continue;
+        if (!(f >> count) || tag.size() < 2 || tag[0] != 'D' || tag[1] < '0' || tag[1] > '9') return false;
+        char *end;
+        unsigned long depth = std::strtoul(tag.c_str() + 1, &end, 10);
+        if (*end || depth < 1 || depth > unsigned(MAX_PLY)) return false;
+        if (out.nodes.size() < depth) out.nodes.resize(depth, 0);
+        out.nodes[depth - 1] = count;
+    }
+    return !out.nodes.empty();
+}
@@ -0,0 +1,25 @@
+#ifndef CHESS_PERFT_H
+#define CHESS_PERFT_H
+
+#include "rules.h"
+#include "tt.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PerftCase {
+    std::string name;
+    std::string fen;
+    std::vector<uint64_t> nodes;    // nodes[d - 1] is the leaf count at depth d
+};
+
+uint64_t perft(GameState &g, int depth);
+// Same counts, but subtrees already counted at the same depth come from tt.
+uint64_t perftHashed(GameState &g, int depth, TranspositionTable &tt, TTStats *stats = nullptr);
+std::vector<std::pair<Move, uint64_t>> perftDivide(GameState &g, int depth);
+const std::vector<PerftCase> &perftSuite();
+bool parseEpdLine(const std::string &line, PerftCase &out);
+
+#endif
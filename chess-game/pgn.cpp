@@ -0,0 +1,331 @@
+#include "pgn.h"
+#include "mappedfile.h"
+#include "movegen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+inline bool endsToken(char c) { return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == ';'; }
+
+bool isResult(const char *p, size_t n) {
+    return (n == 3 && (!std::memcmp(p, "1-0", 3) || !std::memcmp(p, "0-1", 3)))
+        || (n == 7 && !std::memcmp(p, "1/2-1/2", 7)) || (n == 1 && *p == '*');
+}
+
+// Skips a comment, a rest-of-line comment or a (possibly nested) variation
+// starting at p; returns where scanning resumes.
+const char *skipAside(const char *p, const char *end) {
+    if (*p == '{') {
+        const char *close = static_cast<const char *>(std::memchr(p, '}', end - p));
+        return close ? close + 1 : end;
+    }
+    if (*p == ';') {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        return eol ? eol + 1 : end;
+    }
+    int depth = 0;
+    while (p < end) {
+        if (*p == '{' || *p == ';') {
+            p = skipAside(p, end);
+            continue;
+        }
+        if (*p == '(') ++depth;
+        else if (*p == ')' && --depth == 0) return p + 1;
+        ++p;
+    }
+    return end;
+}
+
+}
+
+size_t nextPgnGame(const char *data, size_t size, size_t from) {
+    if (from == 0) return 0;
+    for (size_t i = from; i < size; ++i) {
+        const char *p = static_cast<const char *>(std::memchr(data + i, '[', size - i));
+        if (!p) break;
+        i = size_t(p - data);
+        if (data[i - 1] != '\n') continue;
+        if (i == 1 || data[i - 2] == '\n' || (i >= 3 && data[i - 2] == '\r' && data[i - 3] == '\n')) return i;
+    }
+    return size;
+}
+
+bool replayPgnGame(const char *p, const char *end, GameState &g, PgnGame &out, bool keepRecord) {
+    out.plies = 0;
+    out.result.clear();
+    out.error.clear();
+    out.moves.clear();
+    out.keys.clear();
+    out.tags.clear();
+    std::string fen, resultTag;
+
+    for (;;) {
+        while (p < end && isSpace(*p)) ++p;
+        if (p == end || *p != '[') break;
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        const char *name = ++p;
+        while (p < eol && !isSpace(*p) && *p != '"' && *p != ']') ++p;
+        size_t nameLength = size_t(p - name);
+        const char *open = static_cast<const char *>(std::memchr(p, '"', eol - p));
+        if (open) {
+            std::string value;
+            for (const char *v = open + 1; v < eol && *v != '"'; ++v) {
+                if (*v == '\\' && v + 1 < eol) ++v;
+                value += *v;
+            }
+            if (nameLength == 3 && !std::memcmp(name, "FEN", 3)) fen = value;
+            else if (nameLength == 6 && !std::memcmp(name, "Result", 6)) resultTag = value;
+            if (keepRecord) out.tags.emplace_back(std::string(name, nameLength), value);
+        }
+        p = eol;
+    }
+
+    if (fen.empty()) {
+        initBoard(g);
+    } else if (!loadFen(g, fen)) {
+        out.error = "invalid FEN tag";
+        return false;
+    }
+
+    while (p < end) {
+        char c = *p;
+        if (isSpace(c)) {
+            ++p;
+            continue;
+        }
+        if (c == '{' || c == ';' || c == '(') {
+            p = skipAside(p, end);
+            continue;
+        }
+        if (c == '$') {
+            ++p;
+            while (p < end && *p >= '0' && *p <= '9') ++p;
+            continue;
+        }
+        if (c == ')' || c == '}') {
+            out.error = std::string("unbalanced '") + c + "'";
+            return false;
+        }
+        const char *token = p;
+        while (p < end && !endsToken(*p)) ++p;
+        size_t length = size_t(p - token);
+        if (isResult(token, length)) {
+            out.result.assign(token, length);
+            break;
+        }
+        // Move numbers, "12." or "12...", possibly glued to the move. Digits
+        // followed by anything else are a move such as "0-0".
+        if (c >= '0' && c <= '9') {
+            const char *q = token;
+            while (q < p && *q >= '0' && *q <= '9') ++q;
+            if (q == p) continue;
+            if (*q == '.') {
+                while (q < p && *q == '.') ++q;
+                length = size_t(p - q);
+                token = q;
+                if (!length) continue;
+            }
+        }
+        Move m;
+        if (!parseSan(g, token, length, m)) {
+            out.error = "ply " + std::to_string(out.plies + 1) + ": illegal move " + std::string(token, length);
+            return false;
+        }
+        makeMove(g, m);
+        ++out.plies;
+    }
+
+    if (keepRecord) {
+        out.moves.reserve(g.moveStack.size());
+        for (const UndoInfo &u : g.moveStack) out.moves.push_back(u.move);
+        out.keys = g.keys;
+        out.keys.push_back(g.hash);
+    }
+    if (out.result.empty()) {
+        out.error = "no termination marker";
+        return false;
+    }
+    if (!resultTag.empty() && resultTag != out.result) {
+        out.error = "Result tag " + resultTag + " but movetext ends " + out.result;
+        return false;
+    }
+    if (out.result != "*" && !hasLegalMoves(g, g.whiteTurn) && isInCheck(g, g.whiteTurn)) {
+        const char *expected = g.whiteTurn ? "0-1" : "1-0";
+        if (out.result != expected) {
+            out.error = "checkmate but result " + out.result;
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+struct Chunk {
+    std::vector<PgnGame> games;
+    uint64_t plies = 0;
+    bool done = false;
+};
+
+// Each worker owns a deque of chunk numbers, takes from its front and,
+// when it runs dry, steals from the back of the others'.
+class PgnPool {
+public:
+    PgnPool(const MappedFile &file, const PgnOptions &options, int window)
+        : data(reinterpret_cast<const char *>(file.data())), size(file.size()), chunkBytes(options.chunkBytes),
+          keepRecord(options.keepRecord), queues(options.threads), slots(window) {}
+
+    void start(int threads) {
+        for (int i = 0; i < threads; ++i) workers.emplace_back(&PgnPool::run, this, i);
+    }
+
+    void submit(size_t chunk) {
+        Chunk &slot = slots[chunk % slots.size()];
+        slot.games.clear();
+        slot.plies = 0;
+        slot.done = false;
+        Queue &q = queues[chunk % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.chunks.push_back(chunk);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until the chunk is done; its slot stays valid until it is
+    // submitted again.
+    Chunk &wait(size_t chunk) {
+        Chunk &slot = slots[chunk % slots.size()];
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return slot.done; });
+        return slot;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &w : workers) w.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> chunks;
+    };
+
+    bool take(int self, size_t &chunk) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            Queue &q = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.chunks.empty()) continue;
+            if (i == 0) {
+                chunk = q.chunks.front();
+                q.chunks.pop_front();
+            } else {
+                chunk = q.chunks.back();
+                q.chunks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void run(int self) {
+        GameState g;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return quit || queued > 0; });
+                if (quit) return;
+                --queued;
+            }
+            size_t chunk;
+            if (!take(self, chunk)) continue;
+            Chunk &slot = slots[chunk % slots.size()];
+            replayChunk(chunk, g, slot);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.done = true;
+            }
+            finished.notify_all();
+        }
+    }
+
+    // The chunk owns every game that starts inside it; the last one may run
+    // on into the next chunk's bytes.
+    void replayChunk(size_t chunk, GameState &g, Chunk &slot) {
+        size_t begin = chunk * chunkBytes, end = std::min(size, begin + chunkBytes);
+        size_t pos = nextPgnGame(data, size, begin);
+        while (pos < end) {
+            size_t next = nextPgnGame(data, size, pos + 1);
+            slot.games.emplace_back();
+            PgnGame &game = slot.games.back();
+            game.offset = pos;
+            replayPgnGame(data + pos, data + next, g, game, keepRecord);
+            slot.plies += game.plies;
+            pos = next;
+        }
+    }
+
+    const char *data;
+    size_t size;
+    size_t chunkBytes;
+    bool keepRecord;
+    std::vector<Queue> queues;
+    std::vector<Chunk> slots;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    size_t queued = 0;    // chunk numbers in the deques, so idle workers can sleep
+    bool quit = false;
+};
+
+}
+
+bool checkPgnFile(const std::string &path, const PgnOptions &options, const PgnSink &sink, PgnStats &stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path, false)) return false;
+    PgnOptions o = options;
+    o.threads = std::max(1, o.threads);
+    o.chunkBytes = std::max<size_t>(o.chunkBytes, 4096);
+    int window = o.window > 0 ? o.window : 4 * o.threads;
+    size_t chunks = (file.size() + o.chunkBytes - 1) / o.chunkBytes;
+
+    PgnPool pool(file, o, window);
+    pool.start(o.threads);
+    stats = PgnStats();
+    stats.bytes = file.size();
+    size_t submitted = 0;
+    for (size_t head = 0; head < chunks; ++head) {
+        while (submitted < chunks && submitted < head + size_t(window)) pool.submit(submitted++);
+        Chunk &chunk = pool.wait(head);
+        for (PgnGame &game : chunk.games) {
+            game.index = ++stats.games;
+            if (!game.error.empty()) ++stats.errors;
+        }
+        stats.plies += chunk.plies;
+        sink(chunk.games);
+        file.release(head * o.chunkBytes, o.chunkBytes);
+    }
+    pool.stop();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
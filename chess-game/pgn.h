@@ -0,0 +1,64 @@
+#ifndef CHESS_PGN_H
+#define CHESS_PGN_H
+
+#include "rules.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What replaying one game found.
+struct PgnGame {
+    uint64_t index = 0;     // 1-based place in the file, assigned as games are handed out in order
+    uint64_t offset = 0;    // byte offset of the game's first line
+    int plies = 0;          // moves replayed, up to the first error
+    std::string result;     // the movetext's termination marker ("1-0", "*", ...), empty if missing
+    std::string error;      // empty if the game replayed cleanly
+
+    // Kept only when asked for, by importers:
+    std::vector<PackedMove> moves;    // the moves replayed
+    std::vector<uint64_t> keys;       // Zobrist key before each move, then after the last
+    std::vector<std::pair<std::string, std::string>> tags;
+};
+
+// Replays one game from its text: the tag pairs (a FEN tag sets up the
+// start; one loadFen rejects, such as a king left in check, is an error),
+// then the movetext with comments, variations and NAGs skipped. Checks
+// every move for legality, and the termination marker against the
+// Result tag and against a final mate. g is scratch, so a worker can reuse
+// one across games. keepRecord also fills out.moves, keys and tags. False
+// if out.error was set.
+bool replayPgnGame(const char *begin, const char *end, GameState &g, PgnGame &out, bool keepRecord = false);
+
+// Offset of the first game starting at or after from, or size if none. A
+// game starts at a '[' opening the line after a blank line, or at offset 0.
+size_t nextPgnGame(const char *data, size_t size, size_t from);
+
+struct PgnOptions {
+    int threads = 1;
+    size_t chunkBytes = 1 << 20;    // the unit of work; a chunk owns the games that start in it
+    int window = 0;                 // chunks in flight at once, 0 for four per thread
+    bool keepRecord = false;        // see replayPgnGame
+};
+
+struct PgnStats {
+    uint64_t games = 0;
+    uint64_t plies = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+};
+
+// Receives each chunk's games on the calling thread, in file order.
+typedef std::function<void(const std::vector<PgnGame> &)> PgnSink;
+
+// Maps the file and replays every game in it on a work-stealing pool.
+// Only a window of chunks is in flight at a time, and the pages of
+// finished chunks are handed back to the OS. So memory use depends on the
+// chunk size, the window and the thread count, not on the file size.
+// False if the file cannot be opened.
+bool checkPgnFile(const std::string &path, const PgnOptions &options, const PgnSink &sink, PgnStats &stats);
+
+#endif
@@ -0,0 +1,117 @@
+#include "psqt.h"
+#include "eval.h"
+
+namespace {
+
+constexpr int PHASE_WEIGHTS[6] = {0, 1, 1, 2, 4, 0};
+
+// Middlegame piece-square bonuses for white, laid out as the board is drawn
+// (a8 first), which is also our square order. Black reads them mirrored
+// with sq ^ 56.
+constexpr int PST_MG[6][64] = {
+    {  0,  0,  0,  0,  0,  0,  0,  0,
+      50, 50, 50, 50, 50, 50, 50, 50,
+      10, 10, 20, 30, 30, 20, 10, 10,
+       5,  5, 10, 25, 25, 10,  5,  5,
+       0,  0,  0, 20, 20,  0,  0,  0,
+       5, -5,-10,  0,  0,-10, -5,  5,
+       5, 10, 10,-20,-20, 10, 10,  5,
+       0,  0,  0,  0,  0,  0,  0,  0},
+    {-50,-40,-30,-30,-30,-30,-40,-50,
+     -40,-20,  0,  0,  0,  0,-20,-40,
+     -30,  0, 10, 15, 15, 10,  0,-30,
+     -30,  5, 15, 20, 20, 15,  5,-30,
+     -30,  0, 15, 20, 20, 15,  0,-30,
+     -30,  5, 10, 15, 15, 10,  5,-30,
+     -40,-20,  0,  5,  5,  0,-20,-40,
+     -50,-40,-30,-30,-30,-30,-40,-50},
+    {-20,-10,-10,-10,-10,-10,-10,-20,
+     -10,  0,  0,  0,  0,  0,  0,-10,
+     -10,  0,  5, 10, 10,  5,  0,-10,
+     -10,  5,  5, 10, 10,  5,  5,-10,
+     -10,  0, 10, 10, 10, 10,  0,-10,
+     -10, 10, 10, 10, 10, 10, 10,-10,
+     -10,  5,  0,  0,  0,  0,  5,-10,
+     -20,-10,-10,-10,-10,-10,-10,-20},
+    {  0,  0,  0,  0,  0,  0,  0,  0,
+       5, 10, 10, 10, 10, 10, 10,  5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+      -5,  0,  0,  0,  0,  0,  0, -5,
+       0,  0,  0,  5,  5,  0,  0,  0},
+    {-20,-10,-10, -5, -5,-10,-10,-20,
+     -10,  0,  0,  0,  0,  0,  0,-10,
+     -10,  0,  5,  5,  5,  5,  0,-10,
+      -5,  0,  5,  5,  5,  5,  0, -5,
+       0,  0,  5,  5,  5,  5,  0, -5,
+     -10,  5,  5,  5,  5,  5,  0,-10,
+     -10,  0,  5,  0,  0,  0,  0,-10,
+     -20,-10,-10, -5, -5,-10,-10,-20},
+    {-30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -30,-40,-40,-50,-50,-40,-40,-30,
+     -20,-30,-30,-40,-40,-30,-30,-20,
+     -10,-20,-20,-20,-20,-20,-20,-10,
+      20, 20,  0,  0,  0,  0, 20, 20,
+      20, 30, 10,  0,  0, 10, 30, 20},
+};
+
+// In the endgame pawns gain with every step forward and the king belongs in
+// the centre; the other pieces keep their middlegame squares.
+constexpr int PAWN_EG[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+     80, 80, 80, 80, 80, 80, 80, 80,
+     50, 50, 50, 50, 50, 50, 50, 50,
+     30, 30, 30, 30, 30, 30, 30, 30,
+     15, 15, 15, 15, 15, 15, 15, 15,
+      5,  5,  5,  5,  5,  5,  5,  5,
+      0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+constexpr int KING_EG[64] = {
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50,
+};
+
+constexpr PsqTable buildPsqTable() {
+    PsqTable t{};
+    for (int pt = PAWN; pt <= KING; ++pt) {
+        const int *eg = pt == PAWN ? PAWN_EG : pt == KING ? KING_EG : PST_MG[pt];
+        for (int sq = 0; sq < 64; ++sq) {
+            Score s;
+            s.mg = PIECE_VALUES[pt] + PST_MG[pt][sq];
+            s.eg = PIECE_VALUES_EG[pt] + eg[sq];
+            t.scores[WHITE][pt][sq] = s;
+            t.scores[BLACK][pt][sq ^ 56].mg = -s.mg;
+            t.scores[BLACK][pt][sq ^ 56].eg = -s.eg;
+        }
+        t.phase[pt] = PHASE_WEIGHTS[pt];
+    }
+    return t;
+}
+
+}
+
+extern constexpr PsqTable PSQT = buildPsqTable();
+
+Score computePsq(const Position &pos, int &phase) {
+    Score score;
+    phase = 0;
+    for (int c = WHITE; c <= BLACK; ++c)
+        for (int pt = PAWN; pt <= KING; ++pt) {
+            Bitboard b = pos.pieces[c][pt];
+            phase += PSQT.phase[pt] * popcount(b);
+            while (b) score += PSQT.scores[c][pt][popLsb(b)];
+        }
+    return score;
+}
@@ -0,0 +1,42 @@
+#ifndef CHESS_PSQT_H
+#define CHESS_PSQT_H
+
+#include "bitboard.h"
+
+// A middlegame and an endgame value, blended by game phase at evaluation.
+struct Score {
+    int mg = 0;
+    int eg = 0;
+
+    Score &operator+=(const Score &o) { mg += o.mg; eg += o.eg; return *this; }
+    Score &operator-=(const Score &o) { mg -= o.mg; eg -= o.eg; return *this; }
+};
+
+inline Score operator+(Score a, const Score &b) { return a += b; }
+inline Score operator-(Score a, const Score &b) { return a -= b; }
+inline bool operator==(const Score &a, const Score &b) { return a.mg == b.mg && a.eg == b.eg; }
+inline bool operator!=(const Score &a, const Score &b) { return !(a == b); }
+
+// Material plus piece-square bonus for every piece on every square, from
+// white's point of view (black entries are mirrored and negated), and the
+// phase weight each piece type contributes.
+struct PsqTable {
+    Score scores[2][6][64];
+    int phase[6];
+};
+
+const int PHASE_MAX = 24;    // both sides' minor pieces, rooks and queens at the start
+
+extern const PsqTable PSQT;
+
+inline Score pieceScore(char p, int sq) {
+    return PSQT.scores[pieceColor(p)][pieceTypeOf(p)][sq];
+}
+
+inline int piecePhase(char p) { return PSQT.phase[pieceTypeOf(p)]; }
+
+// Sums the table over pos, for setting up a position and for checking the
+// values makeMove keeps.
+Score computePsq(const Position &pos, int &phase);
+
+#endif
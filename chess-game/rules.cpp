@@ -0,0 +1,735 @@
+#include "rules.h"
+#include "movegen.h"
+#include "tablebase.h"
+#include "zobrist.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// Rights that survive a move touching each square: moving or capturing on a
+// king or rook home square drops the matching rights.
+constexpr std::array<int, 64> castlingMaskTable() {
+    std::array<int, 64> t{};
+    for (int sq = 0; sq < 64; ++sq) t[sq] = WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO;
+    t[0] &= ~BLACK_OOO;
+    t[4] &= ~(BLACK_OO | BLACK_OOO);
+    t[7] &= ~BLACK_OO;
+    t[56] &= ~WHITE_OOO;
+    t[60] &= ~(WHITE_OO | WHITE_OOO);
+    t[63] &= ~WHITE_OO;
+    return t;
+}
+
+constexpr std::array<int, 64> CASTLING_MASK = castlingMaskTable();
+
+const char PIECE_LETTERS[2][7] = {"PNBRQK", "pnbrqk"};
+
+// Board and bitboard updates for a piece whose color and type are known.
+template <Color C>
+inline void setSquare(GameState &g, int sq, PieceType t) {
+    g.board[squareY(sq)][squareX(sq)] = PIECE_LETTERS[C][t];
+    g.pos.put<C>(sq, t);
+}
+
+template <Color C>
+inline void clearSquare(GameState &g, int sq, PieceType t) {
+    g.board[squareY(sq)][squareX(sq)] = '.';
+    g.pos.remove<C>(sq, t);
+}
+
+template <Color C>
+inline void moveSquare(GameState &g, int from, int to, PieceType t) {
+    g.board[squareY(to)][squareX(to)] = g.board[squareY(from)][squareX(from)];
+    g.board[squareY(from)][squareX(from)] = '.';
+    g.pos.move<C>(from, to, t);
+}
+
+// Only record an en passant square the side to move could actually capture on,
+// so that equal positions compare equal.
+int capturableEpSquare(const GameState &g, int sq) {
+    Color us = g.whiteTurn ? WHITE : BLACK;
+    return (PAWN_ATTACKS[us ^ 1][sq] & g.pos.pieces[us][PAWN]) ? sq : -1;
+}
+
+#ifdef CHESS_VERIFY_HASH
+// Debug builds compare the incremental key with a from-scratch one after every change.
+void verifyHash(const GameState &g, const char *where) {
+    uint64_t expected = computeHash(g);
+    if (g.hash != expected) {
+        std::fprintf(stderr, "%s: hash %016llx != recomputed %016llx for %s\n", where,
+                     (unsigned long long)g.hash, (unsigned long long)expected, toFen(g).c_str());
+        std::abort();
+    }
+}
+#endif
+
+#ifdef CHESS_VERIFY_EVAL
+void verifyEval(const GameState &g, const char *where) {
+    int phase;
+    Score expected = computePsq(g.pos, phase);
+    if (g.psq != expected || g.phase != phase) {
+        std::fprintf(stderr, "%s: psq %d/%d phase %d != recomputed %d/%d phase %d for %s\n", where, g.psq.mg,
+                     g.psq.eg, g.phase, expected.mg, expected.eg, phase, toFen(g).c_str());
+        std::abort();
+    }
+    if (g.nnue && !g.nnueStack.empty()) {
+        NnueAccumulator fresh;
+        g.nnue->refresh(g.pos, fresh);
+        if (std::memcmp(&fresh, &g.nnueStack.back(), sizeof fresh) != 0) {
+            std::fprintf(stderr, "%s: NNUE accumulator != recomputed for %s\n", where, toFen(g).c_str());
+            std::abort();
+        }
+    }
+}
+#endif
+
+void setLastMove(GameState &g) {
+    if (!g.moveStack.empty() && g.moveStack.back().move) {
+        Move prev = unpackMove(g.moveStack.back().move);
+        g.lastMoveFromX = prev.sx;
+        g.lastMoveFromY = prev.sy;
+        g.lastMoveToX = prev.tx;
+        g.lastMoveToY = prev.ty;
+    } else {
+        g.lastMoveFromX = g.lastMoveFromY = -1;
+        g.lastMoveToX = g.lastMoveToY = -1;
+    }
+}
+
+}
+
+void initBoard(GameState &g) {
+    const char* start[8] = {
+        "rnbqkbnr",
+        "pppppppp",
+        "........",
+        "........",
+        "........",
+        "........",
+        "PPPPPPPP",
+        "RNBQKBNR"
+    };
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            g.board[y][x] = start[y][x];
+        }
+    }
+    syncPosition(g);
+    g.selX = g.selY = -1;
+    g.whiteTurn = true;
+    g.moveCount = 0;
+    g.castlingRights = WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO;
+    g.epSquare = -1;
+    g.halfmoveClock = 0;
+    g.pliesSinceNull = NO_NULL_MOVE;
+    g.moveStack.clear();
+    g.keys.clear();
+    g.moveStack.reserve(256);
+    g.keys.reserve(256);
+    g.gameOver = false;
+    g.gameResult.clear();
+    g.lastMoveFromX = g.lastMoveFromY = -1;
+    g.lastMoveToX = g.lastMoveToY = -1;
+    g.whiteCaptures = g.blackCaptures = 0;
+    g.hash = computeHash(g);
+    g.psq = computePsq(g.pos, g.phase);
+    setNnue(g, g.nnue);
+    g.legalCache.valid = false;
+    clearLegalMoves(g);
+}
+
+bool loadFen(GameState &g, const std::string &fen) {
+    std::istringstream in(fen);
+    std::string placement, side, castling = "-", ep = "-";
+    int halfmove = 0, fullmove = 1;
+    if (!(in >> placement >> side)) return false;
+    in >> castling >> ep >> halfmove >> fullmove;
+
+    initBoard(g);
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            g.board[y][x] = '.';
+
+    int x = 0, y = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (x != 8) return false;
+            ++y; x = 0;
+        } else if (c >= '1' && c <= '8') {
+            x += c - '0';
+        } else if (std::strchr("PNBRQKpnbrqk", c) && isInside(x, y)) {
+            g.board[y][x++] = c;
+        } else {
+            return false;
+        }
+        if (x > 8) return false;
+    }
+    if (y != 7 || x != 8) return false;
+    syncPosition(g);
+    if (popcount(g.pos.pieces[WHITE][KING]) != 1 || popcount(g.pos.pieces[BLACK][KING]) != 1) return false;
+
+    if (side != "w" && side != "b") return false;
+    g.whiteTurn = side == "w";
+    // Positions no game can reach, which move generation assumes away.
+    if ((g.pos.pieces[WHITE][PAWN] | g.pos.pieces[BLACK][PAWN]) & (ROW_1 | ROW_8)) return false;
+    if (isInCheck(g, !g.whiteTurn)) return false;
+
+    // Ignore rights the piece placement contradicts.
+    g.castlingRights = 0;
+    if (castling.find('K') != std::string::npos && g.board[7][4] == 'K' && g.board[7][7] == 'R') g.castlingRights |= WHITE_OO;
+    if (castling.find('Q') != std::string::npos && g.board[7][4] == 'K' && g.board[7][0] == 'R') g.castlingRights |= WHITE_OOO;
+    if (castling.find('k') != std::string::npos && g.board[0][4] == 'k' && g.board[0][7] == 'r') g.castlingRights |= BLACK_OO;
+    if (castling.find('q') != std::string::npos && g.board[0][4] == 'k' && g.board[0][0] == 'r') g.castlingRights |= BLACK_OOO;
+
+    // An en passant square must be one the opponent's last move, a double
+    // push, just crossed. Whether a pawn of ours can take there is optional.
+    if (ep != "-") {
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (g.whiteTurn ? '6' : '3')) return false;
+        int epX = ep[0] - 'a', epY = '8' - ep[1], dir = g.whiteTurn ? 1 : -1;
+        if (g.board[epY][epX] != '.' || g.board[epY - dir][epX] != '.' || g.board[epY + dir][epX] != (g.whiteTurn ? 'p' : 'P'))
+            return false;
+        g.epSquare = capturableEpSquare(g, makeSquare(epX, epY));
+    }
+    g.halfmoveClock = halfmove;
+    g.moveCount = (std::max)(fullmove - 1, 0) * 2 + (g.whiteTurn ? 0 : 1);
+    g.hash = computeHash(g);
+    g.psq = computePsq(g.pos, g.phase);
+    setNnue(g, g.nnue);
+    return true;
+}
+
+std::string toFen(const GameState &g) {
+    std::string fen;
+    for (int y = 0; y < 8; ++y) {
+        int empty = 0;
+        for (int x = 0; x < 8; ++x) {
+            char p = g.board[y][x];
+            if (p == '.') { ++empty; continue; }
+            if (empty) { fen += char('0' + empty); empty = 0; }
+            fen += p;
+        }
+        if (empty) fen += char('0' + empty);
+        if (y < 7) fen += '/';
+    }
+    fen += g.whiteTurn ? " w " : " b ";
+    if (g.castlingRights & WHITE_OO) fen += 'K';
+    if (g.castlingRights & WHITE_OOO) fen += 'Q';
+    if (g.castlingRights & BLACK_OO) fen += 'k';
+    if (g.castlingRights & BLACK_OOO) fen += 'q';
+    if (!g.castlingRights) fen += '-';
+    fen += ' ';
+    if (g.epSquare >= 0) {
+        fen += char('a' + squareX(g.epSquare));
+        fen += char('8' - squareY(g.epSquare));
+    } else {
+        fen += '-';
+    }
+    fen += ' ' + std::to_string(g.halfmoveClock) + ' ' + std::to_string(g.moveCount / 2 + 1);
+    return fen;
+}
+
+void syncPosition(GameState &g) {
+    g.pos.clear();
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            if (g.board[y][x] != '.') g.pos.put(makeSquare(x, y), g.board[y][x]);
+}
+
+uint64_t computeHash(const GameState &g) {
+    uint64_t key = ZOBRIST.castling[g.castlingRights];
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            if (g.board[y][x] != '.') key ^= pieceKey(g.board[y][x], makeSquare(x, y));
+    if (g.epSquare >= 0) key ^= ZOBRIST.epFile[squareX(g.epSquare)];
+    if (!g.whiteTurn) key ^= ZOBRIST.blackToMove;
+    return key;
+}
+
+std::string moveToString(const Move &m) {
+    std::string s;
+    s += (char)('a' + m.sx);
+    s += (char)('8' - m.sy);
+    s += (char)('a' + m.tx);
+    s += (char)('8' - m.ty);
+    if (m.kind == MOVE_PROMOTION) s += pieceChar(BLACK, m.promotion);
+    return s;
+}
+
+std::string moveToSan(GameState &g, const Move &m) {
+    std::string s;
+    if (m.kind == MOVE_CASTLING) {
+        s = m.tx > m.sx ? "O-O" : "O-O-O";
+    } else {
+        char p = g.board[m.sy][m.sx];
+        PieceType moved = pieceTypeOf(p);
+        bool capture = m.kind == MOVE_EN_PASSANT || g.board[m.ty][m.tx] != '.';
+        if (moved == PAWN) {
+            if (capture) s += char('a' + m.sx);
+        } else {
+            s += pieceChar(WHITE, moved);
+            // Another piece of the same kind reaching the square: the file
+            // if it tells them apart, else the rank, else both.
+            MoveList list;
+            generateLegalMoves(g, isWhitePiece(p) ? WHITE : BLACK, list);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (const Move &o : list) {
+                if (o.tx != m.tx || o.ty != m.ty || (o.sx == m.sx && o.sy == m.sy) || g.board[o.sy][o.sx] != p)
+                    continue;
+                ambiguous = true;
+                sameFile |= o.sx == m.sx;
+                sameRank |= o.sy == m.sy;
+            }
+            if (ambiguous && (!sameFile || sameRank)) s += char('a' + m.sx);
+            if (ambiguous && sameFile) s += char('8' - m.sy);
+        }
+        if (capture) s += 'x';
+        s += char('a' + m.tx);
+        s += char('8' - m.ty);
+        if (m.kind == MOVE_PROMOTION) {
+            s += '=';
+            s += pieceChar(WHITE, m.promotion);
+        }
+    }
+    bool gameOver = g.gameOver;
+    makeMove(g, m);
+    if (isInCheck(g, g.whiteTurn)) s += hasLegalMoves(g, g.whiteTurn) ? '+' : '#';
+    undoMove(g);
+    g.gameOver = gameOver;
+    return s;
+}
+
+std::vector<std::string> sanHistory(const GameState &g) {
+    GameState scratch = g;
+    setNnue(scratch, nullptr);
+    std::vector<PackedMove> moves;
+    moves.reserve(g.moveStack.size());
+    while (!scratch.moveStack.empty()) {
+        moves.push_back(scratch.moveStack.back().move);
+        undoMove(scratch);
+    }
+    std::vector<std::string> text;
+    text.reserve(moves.size());
+    for (auto it = moves.rbegin(); it != moves.rend(); ++it) {
+        Move m = unpackMove(*it);
+        text.push_back(moveToSan(scratch, m));
+        makeMove(scratch, m);
+    }
+    return text;
+}
+
+bool parseSan(const GameState &g, const char *text, size_t length, Move &out) {
+    while (length && std::strchr("+#!?", text[length - 1])) --length;
+    if (length < 2) return false;
+    Color us = g.whiteTurn ? WHITE : BLACK;
+    MoveList list;
+    generateLegalMoves(g, us, list);
+
+    bool castling = length >= 3 && (text[0] == 'O' || text[0] == '0');
+    if (castling) {
+        bool queenSide = length >= 5;
+        for (const Move &m : list) {
+            if (m.kind == MOVE_CASTLING && (m.tx < m.sx) == queenSide) {
+                out = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    PieceType moved = PAWN;
+    size_t i = 0;
+    if (std::strchr("NBRQK", text[0])) moved = pieceTypeOf(text[i++]);
+    PieceType promotion = NO_PIECE_TYPE;
+    if (moved == PAWN && length >= 3 && std::strchr("NBRQ", text[length - 1])) {
+        promotion = pieceTypeOf(text[length - 1]);
+        length -= text[length - 2] == '=' ? 2 : 1;
+    }
+    if (length < i + 2) return false;
+    int tx = text[length - 2] - 'a', ty = '8' - text[length - 1];
+    if (!isInside(tx, ty)) return false;
+    int fromX = -1, fromY = -1;
+    for (size_t j = i; j < length - 2; ++j) {
+        char c = text[j];
+        if (c >= 'a' && c <= 'h') fromX = c - 'a';
+        else if (c >= '1' && c <= '8') fromY = '8' - c;
+        else if (c != 'x' && c != '-') return false;
+    }
+
+    int found = 0;
+    for (const Move &m : list) {
+        if (m.tx != tx || m.ty != ty || pieceTypeOf(g.board[m.sy][m.sx]) != moved) continue;
+        if ((fromX >= 0 && m.sx != fromX) || (fromY >= 0 && m.sy != fromY)) continue;
+        if (m.kind == MOVE_PROMOTION ? m.promotion != promotion : promotion != NO_PIECE_TYPE) continue;
+        if (m.kind == MOVE_CASTLING) continue;
+        out = m;
+        ++found;
+    }
+    return found == 1;
+}
+
+bool parseMove(const GameState &g, const std::string &text, Move &out) {
+    if (text.size() < 4 || text.size() > 5) return false;
+    int sx = text[0] - 'a', sy = '8' - text[1];
+    int tx = text[2] - 'a', ty = '8' - text[3];
+    if (!isInside(sx, sy) || !isInside(tx, ty)) return false;
+    if (g.board[sy][sx] == '.' || isWhitePiece(g.board[sy][sx]) != g.whiteTurn) return false;
+    PieceType promotion = text.size() == 5 ? pieceTypeOf(text[4]) : QUEEN;
+    if (promotion == PAWN || promotion == KING || promotion == NO_PIECE_TYPE) return false;
+    return findLegalMove(g, sx, sy, tx, ty, promotion, out);
+}
+
+bool sameColor(char a, char b) {
+    if (a == '.' || b == '.') return false;
+    return (isWhitePiece(a) && isWhitePiece(b)) || (isBlackPiece(a) && isBlackPiece(b));
+}
+
+bool clearPath(const GameState &g, int sx, int sy, int tx, int ty) {
+    int dx = (tx > sx) ? 1 : (tx < sx) ? -1 : 0;
+    int dy = (ty > sy) ? 1 : (ty < sy) ? -1 : 0;
+    int x = sx + dx, y = sy + dy;
+    while (x != tx || y != ty) {
+        if (g.board[y][x] != '.') return false;
+        x += dx; y += dy;
+    }
+    return true;
+}
+
+bool isSquareAttacked(const GameState &g, int x, int y, bool byWhite) {
+    return g.pos.attacked(makeSquare(x, y), byWhite ? WHITE : BLACK);
+}
+
+bool isInCheck(const GameState &g, bool white) {
+    Color c = white ? WHITE : BLACK;
+    if (!g.pos.pieces[c][KING]) return false;
+    return g.pos.attacked(g.pos.kingSquare(c), white ? BLACK : WHITE);
+}
+
+bool findLegalMove(const GameState &g, int sx, int sy, int tx, int ty, PieceType promotion, Move &out) {
+    if (!isInside(sx, sy) || !isInside(tx, ty)) return false;
+    char p = g.board[sy][sx];
+    if (p == '.' || isWhitePiece(p) != g.whiteTurn) return false;
+    const LegalMoveCache &legal = legalMoveCache(g);
+    if (!(legal.targets[makeSquare(sx, sy)] & squareBB(makeSquare(tx, ty)))) return false;
+    for (const Move &m : legal.moves) {
+        if (m.sx != sx || m.sy != sy || m.tx != tx || m.ty != ty) continue;
+        if (m.kind == MOVE_PROMOTION && m.promotion != promotion) continue;
+        out = m;
+        return true;
+    }
+    return false;
+}
+
+bool isLegalMove(const GameState &g, int sx, int sy, int tx, int ty) {
+    Move m;
+    return findLegalMove(g, sx, sy, tx, ty, QUEEN, m);
+}
+
+bool hasLegalMoves(const GameState &g, bool white) {
+    MoveList list;
+    return generateLegalMoves(g, white ? WHITE : BLACK, list) > 0;
+}
+
+bool isRepetition(const GameState &g) {
+    int n = (int)g.keys.size();
+    int limit = std::min(std::min(g.halfmoveClock, g.pliesSinceNull), n);
+    for (int i = 4; i <= limit; i += 2)
+        if (g.keys[n - i] == g.hash) return true;
+    return false;
+}
+
+int repetitionCount(const GameState &g) {
+    int n = (int)g.keys.size();
+    int limit = std::min(std::min(g.halfmoveClock, g.pliesSinceNull), n);
+    int count = 0;
+    for (int i = 4; i <= limit; i += 2)
+        if (g.keys[n - i] == g.hash) ++count;
+    return count;
+}
+
+// No sequence of legal moves can mate: bare kings, a single minor piece,
+// or only bishops that all stand on squares of one color.
+bool isInsufficientMaterial(const Position &pos) {
+    const Bitboard (*p)[6] = pos.pieces;
+    if (p[WHITE][PAWN] | p[BLACK][PAWN] | p[WHITE][ROOK] | p[BLACK][ROOK] | p[WHITE][QUEEN] | p[BLACK][QUEEN])
+        return false;
+    Bitboard knights = p[WHITE][KNIGHT] | p[BLACK][KNIGHT];
+    Bitboard bishops = p[WHITE][BISHOP] | p[BLACK][BISHOP];
+    if (popcount(knights | bishops) <= 1) return true;
+    const Bitboard LIGHT_SQUARES = 0xAA55AA55AA55AA55ull;    // a8 is light
+    return !knights && (!(bishops & LIGHT_SQUARES) || !(bishops & ~LIGHT_SQUARES));
+}
+
+const LegalMoveCache &legalMoveCache(const GameState &g) {
+    LegalMoveCache &c = g.legalCache;
+    if (c.valid && c.hash == g.hash) return c;
+    Color us = g.whiteTurn ? WHITE : BLACK;
+    MoveList list;
+    generateLegalMoves(g, us, list);
+    c.moves.assign(list.begin(), list.end());
+    std::fill(std::begin(c.targets), std::end(c.targets), Bitboard(0));
+    for (const Move &m : list) c.targets[makeSquare(m.sx, m.sy)] |= squareBB(makeSquare(m.tx, m.ty));
+    c.inCheck = computeCheckInfo(g.pos, us).checkers != 0;
+    c.hash = g.hash;
+    c.valid = true;
+    return c;
+}
+
+void setNnue(GameState &g, const NnueNetwork *net) {
+    g.nnue = net;
+    g.nnueStack.clear();
+    if (!net) return;
+    g.nnueStack.reserve(256);
+    g.nnueStack.emplace_back();
+    net->refresh(g.pos, g.nnueStack.back());
+}
+
+template <Color Us>
+void makeMove(GameState &g, const Move &m) {
+    constexpr Color Them = Color(Us ^ 1);
+    int from = makeSquare(m.sx, m.sy), to = makeSquare(m.tx, m.ty);
+    char p = g.board[m.sy][m.sx];
+    PieceType moved = pieceTypeOf(p);
+
+    UndoInfo u;
+    u.move = packMove(m);
+    u.castlingRights = g.castlingRights;
+    u.epSquare = g.epSquare;
+    u.halfmoveClock = g.halfmoveClock;
+    u.psq = g.psq;
+    u.phase = g.phase;
+    u.pliesSinceNull = g.pliesSinceNull;
+    uint64_t key = g.hash ^ ZOBRIST.castling[g.castlingRights] ^ ZOBRIST.blackToMove;
+    if (g.epSquare >= 0) key ^= ZOBRIST.epFile[squareX(g.epSquare)];
+    int capturedSq = m.kind == MOVE_EN_PASSANT ? makeSquare(m.tx, m.sy) : to;
+    u.captured = g.board[squareY(capturedSq)][squareX(capturedSq)];
+    NnueDelta delta;
+
+    if (u.captured != '.') {
+        PieceType victim = pieceTypeOf(u.captured);
+        key ^= ZOBRIST.pieces[Them][victim][capturedSq];
+        g.psq -= PSQT.scores[Them][victim][capturedSq];
+        g.phase -= PSQT.phase[victim];
+        delta.remove(u.captured, capturedSq);
+        clearSquare<Them>(g, capturedSq, victim);
+        if (Us == WHITE) g.whiteCaptures++;
+        else g.blackCaptures++;
+    }
+    key ^= ZOBRIST.pieces[Us][moved][from] ^ ZOBRIST.pieces[Us][moved][to];
+    g.psq += PSQT.scores[Us][moved][to] - PSQT.scores[Us][moved][from];
+    delta.remove(p, from);
+    delta.add(m.kind == MOVE_PROMOTION ? PIECE_LETTERS[Us][m.promotion] : p, to);
+    moveSquare<Us>(g, from, to, moved);
+    if (m.kind == MOVE_PROMOTION) {
+        key ^= ZOBRIST.pieces[Us][PAWN][to] ^ ZOBRIST.pieces[Us][m.promotion][to];
+        g.psq += PSQT.scores[Us][m.promotion][to] - PSQT.scores[Us][PAWN][to];
+        g.phase += PSQT.phase[m.promotion];
+        clearSquare<Us>(g, to, PAWN);
+        setSquare<Us>(g, to, m.promotion);
+    } else if (m.kind == MOVE_CASTLING) {
+        bool kingSide = m.tx > m.sx;
+        int rookFrom = makeSquare(kingSide ? 7 : 0, m.sy), rookTo = makeSquare(kingSide ? 5 : 3, m.sy);
+        key ^= ZOBRIST.pieces[Us][ROOK][rookFrom] ^ ZOBRIST.pieces[Us][ROOK][rookTo];
+        g.psq += PSQT.scores[Us][ROOK][rookTo] - PSQT.scores[Us][ROOK][rookFrom];
+        delta.remove(PIECE_LETTERS[Us][ROOK], rookFrom);
+        delta.add(PIECE_LETTERS[Us][ROOK], rookTo);
+        moveSquare<Us>(g, rookFrom, rookTo, ROOK);
+    }
+
+    g.castlingRights &= CASTLING_MASK[from] & CASTLING_MASK[to];
+    key ^= ZOBRIST.castling[g.castlingRights];
+    g.halfmoveClock = (u.captured != '.' || moved == PAWN) ? 0 : g.halfmoveClock + 1;
+    g.pliesSinceNull += g.pliesSinceNull < NO_NULL_MOVE;
+    g.moveStack.push_back(u);
+    g.keys.push_back(g.hash);
+    g.moveCount++;
+    g.whiteTurn = !g.whiteTurn;
+    g.epSquare = -1;
+    if (moved == PAWN && abs(m.ty - m.sy) == 2) {
+        // Only record it if the opponent has a pawn that could capture there.
+        int ep = (from + to) / 2;
+        if (PAWN_ATTACKS[Us][ep] & g.pos.pieces[Them][PAWN]) {
+            g.epSquare = ep;
+            key ^= ZOBRIST.epFile[squareX(ep)];
+        }
+    }
+    g.hash = key;
+    if (g.nnue) {
+        g.nnueStack.emplace_back();
+        g.nnue->update(g.nnueStack[g.nnueStack.size() - 2], delta, g.nnueStack.back());
+    }
+
+    g.lastMoveFromX = m.sx;
+    g.lastMoveFromY = m.sy;
+    g.lastMoveToX = m.tx;
+    g.lastMoveToY = m.ty;
+#ifdef CHESS_VERIFY_HASH
+    verifyHash(g, "makeMove");
+#endif
+#ifdef CHESS_VERIFY_EVAL
+    verifyEval(g, "makeMove");
+#endif
+}
+
+template <Color Us>
+void undoMove(GameState &g) {
+    constexpr Color Them = Color(Us ^ 1);
+    if (g.moveStack.empty()) return;
+    const UndoInfo &u = g.moveStack.back();
+    Move m = unpackMove(u.move);
+    int from = makeSquare(m.sx, m.sy), to = makeSquare(m.tx, m.ty);
+
+    if (m.kind == MOVE_CASTLING) {
+        bool kingSide = m.tx > m.sx;
+        moveSquare<Us>(g, makeSquare(kingSide ? 5 : 3, m.sy), makeSquare(kingSide ? 7 : 0, m.sy), ROOK);
+    } else if (m.kind == MOVE_PROMOTION) {
+        clearSquare<Us>(g, to, m.promotion);
+        setSquare<Us>(g, to, PAWN);
+    }
+    moveSquare<Us>(g, to, from, pieceTypeOf(g.board[m.ty][m.tx]));
+
+    if (u.captured != '.') {
+        setSquare<Them>(g, m.kind == MOVE_EN_PASSANT ? makeSquare(m.tx, m.sy) : to, pieceTypeOf(u.captured));
+        if (Us == WHITE) g.whiteCaptures--;
+        else g.blackCaptures--;
+    }
+
+    g.castlingRights = u.castlingRights;
+    g.epSquare = u.epSquare;
+    g.halfmoveClock = u.halfmoveClock;
+    g.pliesSinceNull = u.pliesSinceNull;
+    g.hash = g.keys.back();
+    g.keys.pop_back();
+    g.psq = u.psq;
+    g.phase = u.phase;
+    if (g.nnue) {
+        // Attached mid-game, the stack may not reach back this far
+        if (g.nnueStack.size() > 1) g.nnueStack.pop_back();
+        else g.nnue->refresh(g.pos, g.nnueStack.back());
+    }
+    g.moveStack.pop_back();
+    g.moveCount--;
+    g.whiteTurn = !g.whiteTurn;
+    g.gameOver = false;
+    setLastMove(g);
+#ifdef CHESS_VERIFY_HASH
+    verifyHash(g, "undoMove");
+#endif
+#ifdef CHESS_VERIFY_EVAL
+    verifyEval(g, "undoMove");
+#endif
+}
+
+template void makeMove<WHITE>(GameState &, const Move &);
+template void makeMove<BLACK>(GameState &, const Move &);
+template void undoMove<WHITE>(GameState &);
+template void undoMove<BLACK>(GameState &);
+
+// The mover's color comes from the board rather than whiteTurn, as it
+// always has; the two only differ for callers playing out of turn.
+void makeMove(GameState &g, const Move &m) {
+    if (isWhitePiece(g.board[m.sy][m.sx])) makeMove<WHITE>(g, m);
+    else makeMove<BLACK>(g, m);
+}
+
+void undoMove(GameState &g) {
+    if (g.moveStack.empty()) return;
+    int to = g.moveStack.back().move >> 6 & 63;
+    if (isWhitePiece(g.board[squareY(to)][squareX(to)])) undoMove<WHITE>(g);
+    else undoMove<BLACK>(g);
+}
+
+// Passes the turn for null-move pruning. The halfmove clock counts it as a
+// ply, but repetition scans stop at it: a position before the null move
+// was not reached by moves.
+void makeNullMove(GameState &g) {
+    UndoInfo u;
+    u.move = 0;
+    u.captured = '.';
+    u.castlingRights = g.castlingRights;
+    u.epSquare = g.epSquare;
+    u.halfmoveClock = g.halfmoveClock;
+    u.psq = g.psq;
+    u.phase = g.phase;
+    u.pliesSinceNull = g.pliesSinceNull;
+    g.keys.push_back(g.hash);
+    g.hash ^= ZOBRIST.blackToMove;
+    if (g.epSquare >= 0) g.hash ^= ZOBRIST.epFile[squareX(g.epSquare)];
+    g.epSquare = -1;
+    g.halfmoveClock++;
+    g.pliesSinceNull = 0;
+    g.moveStack.push_back(u);
+    g.moveCount++;
+    g.whiteTurn = !g.whiteTurn;
+#ifdef CHESS_VERIFY_HASH
+    verifyHash(g, "makeNullMove");
+#endif
+}
+
+void undoNullMove(GameState &g) {
+    if (g.moveStack.empty()) return;
+    const UndoInfo &u = g.moveStack.back();
+    g.epSquare = u.epSquare;
+    g.halfmoveClock = u.halfmoveClock;
+    g.pliesSinceNull = u.pliesSinceNull;
+    g.hash = g.keys.back();
+    g.keys.pop_back();
+    g.moveStack.pop_back();
+    g.moveCount--;
+    g.whiteTurn = !g.whiteTurn;
+}
+
+void checkGameEnd(GameState &g, Tablebases *tablebases) {
+    const LegalMoveCache &legal = legalMoveCache(g);
+    if (legal.moves.empty()) {
+        g.gameOver = true;
+        if (legal.inCheck) {
+            g.gameResult = g.whiteTurn ? L"Checkmate! Black Wins!" : L"Checkmate! White Wins!";
+        } else {
+            g.gameResult = L"Stalemate! Draw.";
+        }
+        return;
+    }
+    const wchar_t *draw = NULL;
+    if (g.halfmoveClock >= 100) draw = L"Draw by the fifty-move rule.";
+    else if (repetitionCount(g) >= 2) draw = L"Draw by threefold repetition.";
+    else if (isInsufficientMaterial(g.pos)) draw = L"Draw by insufficient material.";
+    if (draw) {
+        g.gameOver = true;
+        g.gameResult = draw;
+        return;
+    }
+
+    TBResult result;
+    if (!tablebases || !tablebases->probeOutcome(g, result)) return;
+    g.gameOver = true;
+    if (result == TB_WIN || result == TB_LOSS) {
+        bool whiteWins = (result == TB_WIN) == g.whiteTurn;
+        g.gameResult = whiteWins ? L"Tablebase: White Wins!" : L"Tablebase: Black Wins!";
+    } else {
+        g.gameResult = L"Tablebase: Draw.";
+    }
+}
+
+// Only the side to move has moves to highlight.
+void computeLegalMoves(GameState &g, int sx, int sy) {
+    clearLegalMoves(g);
+    if (!isInside(sx, sy)) return;
+    char p = g.board[sy][sx];
+    if (p == '.' || isWhitePiece(p) != g.whiteTurn) return;
+    for (Bitboard b = legalMoveCache(g).targets[makeSquare(sx, sy)]; b; b &= b - 1) {
+        int to = lsb(b);
+        g.legalMoves[squareY(to)][squareX(to)] = true;
+    }
+}
+
+void clearLegalMoves(GameState &g) {
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            g.legalMoves[y][x] = false;
+}
@@ -0,0 +1,173 @@
+#ifndef CHESS_RULES_H
+#define CHESS_RULES_H
+
+#include "bitboard.h"
+#include "nnue.h"
+#include "psqt.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum MoveKind { MOVE_NORMAL, MOVE_PROMOTION, MOVE_EN_PASSANT, MOVE_CASTLING };
+
+struct Move {
+    int sx, sy, tx, ty;
+    MoveKind kind;
+    PieceType promotion;    // piece a pawn becomes, only for MOVE_PROMOTION
+};
+
+inline bool operator==(const Move &a, const Move &b) {
+    return a.sx == b.sx && a.sy == b.sy && a.tx == b.tx && a.ty == b.ty
+        && a.kind == b.kind && (a.kind != MOVE_PROMOTION || a.promotion == b.promotion);
+}
+
+// A move in 16 bits, from | to << 6 | flag << 12, where the flag is the
+// promotion piece (KNIGHT..QUEEN), PACKED_EN_PASSANT, PACKED_CASTLING or 0.
+// The move stack and the transposition table keep moves this way; 0 (a8a8)
+// stands for no move or a null move.
+typedef uint16_t PackedMove;
+const unsigned PACKED_EN_PASSANT = 5;
+const unsigned PACKED_CASTLING = 6;
+
+inline PackedMove packMove(int from, int to, MoveKind kind, PieceType promotion) {
+    unsigned flag = kind == MOVE_PROMOTION ? unsigned(promotion)
+                  : kind == MOVE_EN_PASSANT ? PACKED_EN_PASSANT
+                  : kind == MOVE_CASTLING ? PACKED_CASTLING : 0;
+    return PackedMove(from | to << 6 | flag << 12);
+}
+
+inline PackedMove packMove(const Move &m) {
+    return packMove(makeSquare(m.sx, m.sy), makeSquare(m.tx, m.ty), m.kind, m.promotion);
+}
+
+inline Move unpackMove(PackedMove pm) {
+    int from = pm & 63, to = (pm >> 6) & 63;
+    unsigned flag = pm >> 12;
+    Move m{squareX(from), squareY(from), squareX(to), squareY(to), MOVE_NORMAL, NO_PIECE_TYPE};
+    if (flag == PACKED_EN_PASSANT) m.kind = MOVE_EN_PASSANT;
+    else if (flag == PACKED_CASTLING) m.kind = MOVE_CASTLING;
+    else if (flag) {
+        m.kind = MOVE_PROMOTION;
+        m.promotion = PieceType(flag);
+    }
+    return m;
+}
+
+enum CastlingRight { WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8 };
+
+// The state makeMove overwrites that cannot be recomputed from the move itself;
+// undoMove restores it from here without copying the position. Kept small
+// so a game's whole record, and the search's path, spans few cache lines.
+struct UndoInfo {
+    PackedMove move;
+    char captured;
+    uint8_t castlingRights;
+    int8_t epSquare;
+    int16_t halfmoveClock;
+    Score psq;
+    int16_t phase;
+    int16_t pliesSinceNull;
+};
+
+class Tablebases;
+
+const int NO_NULL_MOVE = INT16_MAX;    // GameState::pliesSinceNull with none on the stack
+
+// Everything the UI asks about the side to move's options, generated once
+// per position. It is tagged with the Zobrist key it was built for, so any
+// change of position, undoMove included, makes it stale without explicit
+// invalidation.
+struct LegalMoveCache {
+    uint64_t hash = 0;
+    bool valid = false;
+    bool inCheck = false;
+    std::vector<Move> moves;
+    Bitboard targets[64] = {};    // destinations by origin square
+};
+
+struct GameState {
+    char board[8][8];
+    Position pos;    // bitboard view of board, kept in sync by every board change
+    int selX = -1, selY = -1;
+    bool whiteTurn = true;
+    bool legalMoves[8][8] = {{false}};
+    int moveCount = 0;
+    int castlingRights = WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO;
+    int epSquare = -1;    // square a pawn may capture onto en passant, or -1
+    int halfmoveClock = 0;
+    int pliesSinceNull = NO_NULL_MOVE;    // caps repetition scans; see makeNullMove()
+    uint64_t hash = 0;    // Zobrist key, updated incrementally by makeMove/undoMove
+    std::vector<uint64_t> keys;    // hash before each move on moveStack, restored by undo
+    Score psq;            // material + piece-square sum for evaluate(), kept the same way
+    int phase = 0;
+    const NnueNetwork *nnue = nullptr;         // evaluates instead of psq when set; see setNnue()
+    std::vector<NnueAccumulator> nnueStack;    // one accumulator per ply, the current one last
+    mutable LegalMoveCache legalCache;         // see legalMoveCache()
+    std::vector<UndoInfo> moveStack;    // also the game record; see sanHistory()
+    char lastCaptured = '.';
+    bool gameOver = false;
+    std::wstring gameResult;
+    int lastMoveFromX = -1, lastMoveFromY = -1;
+    int lastMoveToX = -1, lastMoveToY = -1;
+    int whiteCaptures = 0;
+    int blackCaptures = 0;
+};
+
+inline bool isInside(int x, int y) { return x >= 0 && x < 8 && y >= 0 && y < 8; }
+inline bool isWhitePiece(char p) { return p >= 'A' && p <= 'Z'; }
+inline bool isBlackPiece(char p) { return p >= 'a' && p <= 'z'; }
+
+void initBoard(GameState &g);
+bool loadFen(GameState &g, const std::string &fen);
+std::string toFen(const GameState &g);
+void syncPosition(GameState &g);
+uint64_t computeHash(const GameState &g);
+bool sameColor(char a, char b);
+bool clearPath(const GameState &g, int sx, int sy, int tx, int ty);
+bool isSquareAttacked(const GameState &g, int x, int y, bool byWhite);
+bool isInCheck(const GameState &g, bool white);
+bool findLegalMove(const GameState &g, int sx, int sy, int tx, int ty, PieceType promotion, Move &out);
+bool isLegalMove(const GameState &g, int sx, int sy, int tx, int ty);
+bool hasLegalMoves(const GameState &g, bool white);
+// Draw rules, cheap enough for every search node. Repetition scans look at
+// every other key back to the last capture, pawn move or null move only.
+bool isRepetition(const GameState &g);    // the position occurred before
+int repetitionCount(const GameState &g);   // earlier occurrences; 2 makes a threefold repetition
+bool isInsufficientMaterial(const Position &pos);
+// The side to move's legal moves and check status, from g.legalCache when
+// it matches g.hash. Search and perft generate into MoveLists instead.
+const LegalMoveCache &legalMoveCache(const GameState &g);
+// Attaches a network (or detaches with nullptr) and computes the accumulator
+// for the current position; makeMove and undoMove keep it from then on.
+void setNnue(GameState &g, const NnueNetwork *net);
+void makeMove(GameState &g, const Move &m);
+void undoMove(GameState &g);
+// Specialized on the mover's color, for loops that already know it;
+// makeMove and undoMove above pick one of these from the board.
+template <Color Us> void makeMove(GameState &g, const Move &m);
+template <Color Us> void undoMove(GameState &g);
+void makeNullMove(GameState &g);
+void undoNullMove(GameState &g);
+// Mate and stalemate, the draw rules above (threefold repetition, fifty
+// moves, insufficient material), and with tablebases an early result for
+// positions they cover.
+void checkGameEnd(GameState &g, Tablebases *tablebases = nullptr);
+void computeLegalMoves(GameState &g, int sx, int sy);
+void clearLegalMoves(GameState &g);
+std::string moveToString(const Move &m);
+// Standard algebraic notation for m, which must be legal in g. The move is
+// made and taken back to find check and mate; g ends up as it was.
+std::string moveToSan(GameState &g, const Move &m);
+// The game so far in SAN, one entry per ply. Nothing but the packed moves
+// is stored as the game goes; the text is produced here, on demand, by
+// replaying the move stack on a scratch copy.
+std::vector<std::string> sanHistory(const GameState &g);
+// Reads a SAN move ("Nbd7", "exd5", "O-O", "e8=Q+"), tolerating check and
+// annotation suffixes and 0-0 for castling. False unless exactly one legal
+// move matches. The text need not be terminated, so callers can parse in
+// place from a larger buffer.
+bool parseSan(const GameState &g, const char *text, size_t length, Move &out);
+bool parseMove(const GameState &g, const std::string &text, Move &out);
+
+#endif
@@ -0,0 +1,473 @@
+#include "search.h"
+#include "eval.h"
+#include "movegen.h"
+#include "see.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Transposition entries carry a packed move and a 16-bit score in the low
+// 32 bits of the payload.
+inline uint64_t packEntry(PackedMove move, int score) {
+    return uint64_t(move) | uint64_t(uint16_t(int16_t(score))) << 16;
+}
+
+inline PackedMove entryMove(uint64_t payload) { return PackedMove(payload); }
+inline int entryScore(uint64_t payload) { return int16_t(uint16_t(payload >> 16)); }
+
+// Mate and tablebase scores are stored relative to the node, not the root.
+inline int scoreToTT(int score, int ply) {
+    return score >= SCORE_TB_WIN - MAX_PLY ? score + ply : score <= -SCORE_TB_WIN + MAX_PLY ? score - ply : score;
+}
+
+inline int scoreFromTT(int score, int ply) {
+    return score >= SCORE_TB_WIN - MAX_PLY ? score - ply : score <= -SCORE_TB_WIN + MAX_PLY ? score + ply : score;
+}
+
+std::array<std::array<int, 64>, 64> buildReductions() {
+    std::array<std::array<int, 64>, 64> r{};
+    for (int d = 1; d < 64; ++d)
+        for (int n = 1; n < 64; ++n)
+            r[d][n] = int(0.75 + std::log(double(d)) * std::log(double(n)) / 2.25);
+    return r;
+}
+
+const std::array<std::array<int, 64>, 64> REDUCTIONS = buildReductions();
+
+bool isTactical(const GameState &g, const Move &m) {
+    return m.kind == MOVE_PROMOTION || m.kind == MOVE_EN_PASSANT || g.board[m.ty][m.tx] != '.';
+}
+
+// Most valuable victim first, cheapest attacker breaking ties.
+int captureScore(const GameState &g, const Move &m) {
+    PieceType victim = m.kind == MOVE_EN_PASSANT ? PAWN : pieceTypeOf(g.board[m.ty][m.tx]);
+    int score = victim == NO_PIECE_TYPE ? 0 : PIECE_VALUES[victim] * 8;
+    if (m.kind == MOVE_PROMOTION) score += PIECE_VALUES[m.promotion];
+    return score - pieceTypeOf(g.board[m.sy][m.sx]);
+}
+
+// Ordering keys, highest first: the transposition move, captures that do
+// not lose material (MVV-LVA among them), the two killers, quiet moves by
+// history, and last the captures SEE says lose material.
+const int ORDER_TT_MOVE = 1 << 30;
+const int ORDER_GOOD_CAPTURE = 1 << 24;
+const int ORDER_KILLER = 1 << 20;
+const int ORDER_BAD_CAPTURE = -(1 << 24);
+
+const int HISTORY_MAX = 1 << 14;
+
+// Swaps the best remaining move into slot i, so moves after a cutoff are
+// never ordered.
+void pickMove(PackedMoveList &list, int *scores, int i) {
+    int best = i;
+    for (int j = i + 1; j < list.count; ++j)
+        if (scores[j] > scores[best]) best = j;
+    std::swap(list.moves[i], list.moves[best]);
+    std::swap(scores[i], scores[best]);
+}
+
+bool hasNonPawnMaterial(const Position &pos, Color c) {
+    const Bitboard *own = pos.pieces[c];
+    return (own[KNIGHT] | own[BISHOP] | own[ROOK] | own[QUEEN]) != 0;
+}
+
+// Lazy SMP: helper threads search the same root through the shared table,
+// each starting its iterations at a different phase of a skip schedule so
+// they tend to be one or two plies apart and fill the table for each other.
+const int SKIP_SIZE[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+struct Searcher;
+
+// State common to all threads of one search.
+struct SharedSearch {
+    SearchLimits limits;
+    Clock::time_point start;
+    Clock::time_point clockStart;    // movetime origin, moved to the ponder hit
+    bool pondering = false;
+    std::atomic<bool> stop{false};    // raised by the main thread to end the helpers
+    std::vector<std::unique_ptr<Searcher>> threads;
+
+    uint64_t totalNodes() const;
+};
+
+struct Searcher {
+    GameState g;    // each thread plays on its own copy
+    TranspositionTable &tt;
+    SharedSearch &shared;
+    int id;
+    uint64_t nodes = 0;
+    std::atomic<uint64_t> publishedNodes{0};    // nodes, refreshed every 1024 for the other threads
+    TTStats ttStats;
+    TBStats tbStats;
+    int seldepth = 0;
+    bool aborted = false;
+    bool canAbort = false;    // the main thread always completes its first iteration
+    // Moves are kept packed here and in the move lists, and unpacked only
+    // to be looked at or made.
+    PackedMove pv[MAX_PLY + 1][MAX_PLY + 1];
+    int pvLength[MAX_PLY + 1];
+    PackedMove killers[MAX_PLY + 1][2] = {};    // quiet moves that caused a cutoff at this ply
+    int history[2][64][64] = {};     // quiet cutoff credit by side, from and to square
+
+    Searcher(const GameState &root, TranspositionTable &table, SharedSearch &sh, int threadId)
+        : g(root), tt(table), shared(sh), id(threadId), canAbort(threadId != 0) {
+        if (sh.limits.nnue) setNnue(g, sh.limits.nnue);
+    }
+
+    double elapsed() const { return std::chrono::duration<double>(Clock::now() - shared.start).count(); }
+
+    void checkLimits() {
+        if (nodes & 1023) return;
+        publishedNodes.store(nodes, std::memory_order_relaxed);
+        if (id != 0) {
+            aborted = shared.stop.load(std::memory_order_relaxed);
+            return;
+        }
+        const SearchLimits &limits = shared.limits;
+        if (!canAbort) return;
+        if (limits.stop && limits.stop->load(std::memory_order_relaxed)) {
+            aborted = true;
+            return;
+        }
+        if (shared.pondering) {
+            if (limits.ponder->load(std::memory_order_relaxed)) return;
+            shared.pondering = false;
+            shared.clockStart = Clock::now();
+        }
+        double moveSeconds = std::chrono::duration<double>(Clock::now() - shared.clockStart).count();
+        if ((limits.nodes && shared.totalNodes() >= limits.nodes)
+            || (limits.movetimeMs && moveSeconds * 1000 >= limits.movetimeMs))
+            aborted = true;
+    }
+
+    void updatePv(int ply, PackedMove m) {
+        pv[ply][ply] = m;
+        for (int i = ply + 1; i < pvLength[ply + 1]; ++i) pv[ply][i] = pv[ply + 1][i];
+        pvLength[ply] = pvLength[ply + 1];
+    }
+
+    int &historyOf(Color us, PackedMove m) {
+        return history[us][m & 63][m >> 6 & 63];
+    }
+
+    // Bonuses shrink as an entry approaches HISTORY_MAX, so old credit decays.
+    void updateHistory(Color us, PackedMove m, int bonus) {
+        int &h = historyOf(us, m);
+        h += bonus - h * std::abs(bonus) / HISTORY_MAX;
+    }
+
+    void scoreMoves(const PackedMoveList &list, int *scores, PackedMove ttMove, int ply) {
+        Color us = g.whiteTurn ? WHITE : BLACK;
+        bool heuristics = shared.limits.orderingHeuristics;
+        for (int i = 0; i < list.count; ++i) {
+            PackedMove pm = list.moves[i];
+            Move m = unpackMove(pm);
+            if (ttMove && pm == ttMove) scores[i] = ORDER_TT_MOVE;
+            else if (isTactical(g, m))
+                scores[i] = captureScore(g, m) + (!heuristics || see(g, m) >= 0 ? ORDER_GOOD_CAPTURE : ORDER_BAD_CAPTURE);
+            else if (!heuristics) scores[i] = 0;
+            else if (pm == killers[ply][0]) scores[i] = ORDER_KILLER;
+            else if (pm == killers[ply][1]) scores[i] = ORDER_KILLER - 1;
+            else scores[i] = historyOf(us, pm);
+        }
+    }
+
+    void quietCutoff(PackedMove m, int depth, int ply, const PackedMove *tried, int triedCount) {
+        if (!shared.limits.orderingHeuristics) return;
+        if (m != killers[ply][0]) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = m;
+        }
+        Color us = g.whiteTurn ? WHITE : BLACK;
+        int bonus = std::min(depth * depth, HISTORY_MAX / 4);
+        updateHistory(us, m, bonus);
+        for (int i = 0; i < triedCount; ++i) updateHistory(us, tried[i], -bonus);
+    }
+
+    int quiesce(int alpha, int beta, int ply);
+    int search(int alpha, int beta, int depth, int ply, bool allowNull);
+    void runHelper(int maxDepth);
+};
+
+uint64_t SharedSearch::totalNodes() const {
+    uint64_t total = threads[0]->nodes;
+    for (size_t i = 1; i < threads.size(); ++i) total += threads[i]->publishedNodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+int Searcher::quiesce(int alpha, int beta, int ply) {
+    ++nodes;
+    checkLimits();
+    if (aborted) return 0;
+    seldepth = std::max(seldepth, ply);
+    pvLength[ply] = ply;
+    if (ply >= MAX_PLY) return evaluate(g);
+
+    Color us = g.whiteTurn ? WHITE : BLACK;
+    bool inCheck = isInCheck(g, g.whiteTurn);
+    int best = -SCORE_INFINITE;
+    if (!inCheck) {
+        best = evaluate(g);
+        if (best >= beta) return best;
+        alpha = std::max(alpha, best);
+    }
+
+    // In check every evasion is searched, so running out of them is mate.
+    PackedMoveList list;
+    generateLegalMoves(g, us, list, inCheck ? GEN_ALL : GEN_CAPTURES);
+    if (inCheck && list.empty()) return -SCORE_MATE + ply;
+    int scores[MAX_MOVES];
+    if (!inCheck) {
+        for (int i = 0; i < list.count; ++i) scores[i] = captureScore(g, unpackMove(list.moves[i]));
+    } else {
+        scoreMoves(list, scores, 0, ply);
+    }
+
+    for (int i = 0; i < list.count; ++i) {
+        pickMove(list, scores, i);
+        Move m = unpackMove(list.moves[i]);
+        // A capture that loses material cannot raise a stand-pat score.
+        if (!inCheck && shared.limits.orderingHeuristics && see(g, m) < 0) continue;
+        makeMove(g, m);
+        int score = -quiesce(-beta, -alpha, ply + 1);
+        undoMove(g);
+        if (aborted) return 0;
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(ply, list.moves[i]);
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    return best;
+}
+
+int Searcher::search(int alpha, int beta, int depth, int ply, bool allowNull) {
+    pvLength[ply] = ply;
+    // Inside the tree a single repetition is already a draw; the game
+    // history before the root counts too.
+    if (ply > 0 && (g.halfmoveClock >= 100 || isRepetition(g) || isInsufficientMaterial(g.pos))) return 0;
+
+    Color us = g.whiteTurn ? WHITE : BLACK;
+    bool inCheck = isInCheck(g, g.whiteTurn);
+    if (inCheck) ++depth;
+    if (depth <= 0 || ply >= MAX_PLY) return quiesce(alpha, beta, ply);
+
+    ++nodes;
+    checkLimits();
+    if (aborted) return 0;
+
+    bool pvNode = beta - alpha > 1;
+    PackedMove ttMove = 0;
+    TTData hit;
+    if (tt.probe(g.hash, hit, &ttStats)) {
+        ttMove = entryMove(hit.payload);
+        int ttScore = scoreFromTT(entryScore(hit.payload), ply);
+        if (!pvNode && ply > 0 && hit.depth >= depth
+            && (hit.bound == BOUND_EXACT
+                || (hit.bound == BOUND_LOWER && ttScore >= beta)
+                || (hit.bound == BOUND_UPPER && ttScore <= alpha)))
+            return ttScore;
+    }
+
+    // Right after a capture or pawn move the tables give the exact result;
+    // the clock check keeps probes to positions they can answer cheaply.
+    Tablebases *tb = shared.limits.tablebases;
+    TBResult wdl;
+    if (ply > 0 && g.halfmoveClock == 0 && tb && tb->covers(g) && tb->probeWdl(g, wdl, &tbStats)) {
+        int score = wdl == TB_WIN ? SCORE_TB_WIN - ply : wdl == TB_LOSS ? -SCORE_TB_WIN + ply : int(wdl);
+        tt.store(g.hash, packEntry(0, scoreToTT(score, ply)), std::min(depth + 6, MAX_PLY - 1), BOUND_EXACT);
+        return score;
+    }
+
+    // Null move: if passing still fails high, a real move would too.
+    if (!pvNode && !inCheck && allowNull && depth >= 3 && hasNonPawnMaterial(g.pos, us)
+        && evaluate(g) >= beta) {
+        int r = 3 + depth / 6;
+        makeNullMove(g);
+        int score = -search(-beta, -beta + 1, depth - 1 - r, ply + 1, false);
+        undoNullMove(g);
+        if (aborted) return 0;
+        if (score >= beta) return isMateScore(score) ? beta : score;
+    }
+
+    PackedMoveList list;
+    generateLegalMoves(g, us, list);
+    if (list.empty()) return inCheck ? -SCORE_MATE + ply : 0;
+    int scores[MAX_MOVES];
+    scoreMoves(list, scores, ttMove, ply);
+
+    int originalAlpha = alpha;
+    int best = -SCORE_INFINITE;
+    PackedMove bestMove = list.moves[0];
+    PackedMove quietsTried[MAX_MOVES];
+    int quietCount = 0;
+    for (int i = 0; i < list.count; ++i) {
+        pickMove(list, scores, i);
+        PackedMove pm = list.moves[i];
+        Move m = unpackMove(pm);
+        bool quiet = !isTactical(g, m);
+        makeMove(g, m);
+        bool givesCheck = isInCheck(g, g.whiteTurn);
+        int score;
+        if (i == 0) {
+            score = -search(-beta, -alpha, depth - 1, ply + 1, true);
+        } else {
+            // Late quiet moves are searched shallower first and only
+            // re-searched to full depth if they beat alpha.
+            int r = 0;
+            if (depth >= 3 && i >= 3 && quiet && !inCheck && !givesCheck) {
+                r = REDUCTIONS[std::min(depth, 63)][std::min(i, 63)] + !pvNode;
+                r = std::max(0, std::min(r, depth - 2));
+            }
+            score = -search(-alpha - 1, -alpha, depth - 1 - r, ply + 1, true);
+            if (score > alpha && r > 0) score = -search(-alpha - 1, -alpha, depth - 1, ply + 1, true);
+            if (score > alpha && score < beta) score = -search(-beta, -alpha, depth - 1, ply + 1, true);
+        }
+        undoMove(g);
+        if (aborted) return 0;
+
+        if (score > best) {
+            best = score;
+            bestMove = pm;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(ply, pm);
+                if (alpha >= beta) {
+                    if (quiet) quietCutoff(pm, depth, ply, quietsTried, quietCount);
+                    break;
+                }
+            }
+        }
+        if (quiet) quietsTried[quietCount++] = pm;
+    }
+
+    Bound bound = best >= beta ? BOUND_LOWER : best > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    tt.store(g.hash, packEntry(bestMove, scoreToTT(best, ply)), depth, bound);
+    return best;
+}
+
+void Searcher::runHelper(int maxDepth) {
+    int slot = (id - 1) % 20;
+    for (int depth = 1; depth <= maxDepth && !aborted; ++depth) {
+        if ((depth + SKIP_PHASE[slot]) / SKIP_SIZE[slot] % 2) continue;
+        search(-SCORE_INFINITE, SCORE_INFINITE, depth, 0, false);
+    }
+}
+
+}
+
+SearchResult search(const GameState &root, const SearchLimits &limits, TranspositionTable &tt,
+                    const IterationCallback &onIteration) {
+    SharedSearch shared;
+    shared.limits = limits;
+    shared.start = shared.clockStart = Clock::now();
+    shared.pondering = limits.ponder != nullptr;
+    int threadCount = std::max(1, std::min(limits.threads, MAX_THREADS));
+    for (int i = 0; i < threadCount; ++i) shared.threads.emplace_back(new Searcher(root, tt, shared, i));
+    Searcher &s = *shared.threads[0];
+    SearchResult result;
+    if (limits.newSearch) tt.newSearch();
+
+    MoveList rootMoves;
+    generateLegalMoves(s.g, s.g.whiteTurn ? WHITE : BLACK, rootMoves);
+    if (rootMoves.empty()) return result;
+    result.hasMove = true;
+    result.best = rootMoves.moves[0];
+
+    // A won tablebase position needs no search, only the move that keeps
+    // the win within the fifty-move rule.
+    TBResult rootResult;
+    int rootDtz;
+    Move tbMove;
+    if (limits.tablebases && limits.tablebases->probeRoot(s.g, tbMove, rootResult, rootDtz, &s.tbStats)
+        && rootResult == TB_WIN) {
+        SearchInfo &info = result.info;
+        info.depth = 1;
+        info.score = SCORE_TB_WIN - std::abs(rootDtz);
+        info.pv.assign(1, tbMove);
+        info.tbProbes = s.tbStats.probes;
+        info.tbHits = s.tbStats.hits;
+        info.tbSeconds = s.tbStats.seconds;
+        info.seconds = s.elapsed();
+        result.best = tbMove;
+        if (onIteration) onIteration(info);
+        return result;
+    }
+
+    int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threadCount; ++i)
+        helpers.emplace_back(&Searcher::runHelper, shared.threads[i].get(), maxDepth);
+
+    // Only the main thread's iterations are reported and decide the move.
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        s.seldepth = 0;
+        int score = s.search(-SCORE_INFINITE, SCORE_INFINITE, depth, 0, false);
+        if (s.aborted) break;
+
+        SearchInfo &info = result.info;
+        info.depth = depth;
+        info.seldepth = s.seldepth;
+        info.score = score;
+        info.nodes = shared.totalNodes();
+        info.seconds = s.elapsed();
+        info.pv.clear();
+        for (int i = 0; i < s.pvLength[0]; ++i) info.pv.push_back(unpackMove(s.pv[0][i]));
+        if (!info.pv.empty()) result.best = info.pv[0];
+        if (onIteration) onIteration(info);
+
+        s.canAbort = true;
+        // A forced mate found within this depth will not get any shorter.
+        if (isMateScore(score) && SCORE_MATE - std::abs(score) <= depth) break;
+    }
+
+    shared.stop = true;
+    for (std::thread &t : helpers) t.join();
+    result.info.nodes = 0;
+    for (auto &t : shared.threads) {
+        result.info.nodes += t->nodes;
+        result.info.ttProbes += t->ttStats.probes;
+        result.info.ttHits += t->ttStats.hits;
+        result.info.tbProbes += t->tbStats.probes;
+        result.info.tbHits += t->tbStats.hits;
+        result.info.tbSeconds += t->tbStats.seconds;
+    }
+    result.info.seconds = s.elapsed();
+    return result;
+}
+
+// A mix of openings, middlegames and endgames, including the perft positions.
+const std::vector<std::string> &benchPositions() {
+    static const std::vector<std::string> positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+        "2rq1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1PNBPN2/PB1Q1PPP/2R2RK1 w - - 0 12",
+        "r2q1rk1/1b2bppp/p2ppn2/1p6/3BP3/1BN5/PPPQ1PPP/2KR3R w - - 0 13",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "8/8/4k3/8/2p5/8/B2K4/8 w - - 0 1",
+        "8/5pk1/6p1/8/5P2/6P1/6K1/8 w - - 0 1",
+        "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+        "8/8/8/3k4/8/8/3PK3/8 w - - 0 1",
+        "r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - 0 7",
+    };
+    return positions;
+}
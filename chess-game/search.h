@@ -0,0 +1,70 @@
+#ifndef CHESS_SEARCH_H
+#define CHESS_SEARCH_H
+
+#include "rules.h"
+#include "tablebase.h"
+#include "tt.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+const int MAX_PLY = 128;
+const int MAX_THREADS = 256;
+const int SCORE_INFINITE = 32001;
+const int SCORE_MATE = 32000;    // mate at the root; mate in n plies scores SCORE_MATE - n
+const int SCORE_TB_WIN = SCORE_MATE - 2 * MAX_PLY;    // a tablebase win n plies from the root scores this - n
+
+inline bool isMateScore(int score) { return score >= SCORE_MATE - MAX_PLY || score <= -SCORE_MATE + MAX_PLY; }
+
+// Any limit left at zero is off; with none set the search runs to MAX_PLY
+// or until *stop becomes true. Node limits count all threads. While *ponder
+// is true the node and time limits are held off, and movetime counts from
+// the moment it clears.
+struct SearchLimits {
+    int depth = 0;
+    uint64_t nodes = 0;
+    int64_t movetimeMs = 0;
+    const std::atomic<bool> *stop = nullptr;
+    const std::atomic<bool> *ponder = nullptr;
+    int threads = 1;    // the caller's thread plus threads - 1 helpers sharing the table
+    Tablebases *tablebases = nullptr;    // probed after captures and pawn moves, and at the root
+    const NnueNetwork *nnue = nullptr;   // evaluates leaves instead of the piece-square tables
+    bool orderingHeuristics = true;      // SEE, killers and history; off only to measure them
+    bool newSearch = true;               // age the table first; off when the caller does it for a shared one
+};
+
+// Reported after each completed iteration.
+struct SearchInfo {
+    int depth = 0;
+    int seldepth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    double seconds = 0;
+    std::vector<Move> pv;
+    uint64_t ttProbes = 0;    // filled in for the final result only
+    uint64_t ttHits = 0;
+    uint64_t tbProbes = 0;
+    uint64_t tbHits = 0;
+    double tbSeconds = 0;
+};
+
+struct SearchResult {
+    bool hasMove = false;    // false only when the root has no legal move
+    Move best;
+    SearchInfo info;         // the last completed iteration
+};
+
+typedef std::function<void(const SearchInfo &)> IterationCallback;
+
+// Iterative-deepening principal variation search from root. root itself is
+// not modified; every thread plays on its own copy.
+SearchResult search(const GameState &root, const SearchLimits &limits, TranspositionTable &tt,
+                    const IterationCallback &onIteration = IterationCallback());
+
+// Fixed positions for benchmarking the search (time-to-depth, nodes/sec).
+const std::vector<std::string> &benchPositions();
+
+#endif
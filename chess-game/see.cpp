@@ -0,0 +1,60 @@
+#include "see.h"
+#include "eval.h"
+
+#include <algorithm>
+
+namespace {
+
+inline int seeValue(PieceType t) { return t == KING ? 20000 : PIECE_VALUES[t]; }
+
+}
+
+int see(const GameState &g, const Move &m) {
+    if (m.kind == MOVE_CASTLING) return 0;
+    const Position &pos = g.pos;
+    int from = makeSquare(m.sx, m.sy), to = makeSquare(m.tx, m.ty);
+    char mover = g.board[m.sy][m.sx];
+    Color side = pieceColor(mover);
+    PieceType onSquare = pieceTypeOf(mover);
+    Bitboard occ = pos.occupied ^ squareBB(from);
+
+    // gain[d]: the balance for the side making capture d if the exchange stopped after it
+    int gain[32], d = 0;
+    if (m.kind == MOVE_EN_PASSANT) {
+        gain[0] = seeValue(PAWN);
+        occ ^= squareBB(makeSquare(m.tx, m.sy));
+    } else {
+        char victim = g.board[m.ty][m.tx];
+        gain[0] = victim == '.' ? 0 : seeValue(pieceTypeOf(victim));
+    }
+    if (m.kind == MOVE_PROMOTION) {
+        gain[0] += seeValue(m.promotion) - seeValue(PAWN);
+        onSquare = m.promotion;
+    }
+
+    Bitboard diagonal = pos.pieces[WHITE][BISHOP] | pos.pieces[BLACK][BISHOP]
+                      | pos.pieces[WHITE][QUEEN] | pos.pieces[BLACK][QUEEN];
+    Bitboard straight = pos.pieces[WHITE][ROOK] | pos.pieces[BLACK][ROOK]
+                      | pos.pieces[WHITE][QUEEN] | pos.pieces[BLACK][QUEEN];
+    Bitboard attackers = pos.attackersTo(to, occ) & occ;
+    while (d < 31) {
+        side = Color(side ^ 1);
+        Bitboard ours = attackers & pos.byColor[side];
+        if (!ours) break;
+        int t = PAWN;
+        while (!(ours & pos.pieces[side][t])) ++t;
+        if (t == KING && (attackers & pos.byColor[side ^ 1])) break;
+        ++d;
+        gain[d] = seeValue(onSquare) - gain[d - 1];
+
+        Bitboard b = ours & pos.pieces[side][t];
+        occ ^= b & (0 - b);
+        if (t == PAWN || t == BISHOP || t == QUEEN) attackers |= bishopAttacks(to, occ) & diagonal;
+        if (t == ROOK || t == QUEEN) attackers |= rookAttacks(to, occ) & straight;
+        attackers &= occ;
+        onSquare = PieceType(t);
+    }
+    // Either side may stop capturing whenever going on would cost it.
+    for (; d > 0; --d) gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    return gain[0];
+}
@@ -0,0 +1,13 @@
+#ifndef CHESS_SEE_H
+#define CHESS_SEE_H
+
+#include "rules.h"
+
+// Static exchange evaluation: the material m wins or loses in centipawns
+// once both sides have made every profitable recapture on its destination,
+// always with their least valuable attacker. Sliders lined up behind an
+// attacker join in as it leaves. Pins and checks are ignored, except that a
+// king never recaptures onto a defended square.
+int see(const GameState &g, const Move &m);
+
+#endif
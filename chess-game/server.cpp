@@ -0,0 +1,257 @@
+#include "analysis.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *DEFAULT_SOCKET = "/tmp/chess-analysis.sock";
+const int DEFAULT_HASH_MB = 64;
+const size_t MAX_LINE = 64 * 1024;
+
+void usage() {
+    std::printf("usage: chess-server [--socket PATH | --port N] [--workers N] [--hash MB]\n");
+}
+
+// Written by the signal handler and by workers with answers ready; the
+// poll loop wakes on the read end.
+int wakePipe[2] = {-1, -1};
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) {
+    stopRequested = 1;
+    char c = 0;
+    if (write(wakePipe[1], &c, 1) < 0) {}
+}
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+int listenUnix(const std::string &path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path) {
+        close(fd);
+        return -1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr *)&addr, sizeof addr) < 0 || listen(fd, 128) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Loopback only: the server is for local processes.
+int listenTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(uint16_t(port));
+    if (bind(fd, (sockaddr *)&addr, sizeof addr) < 0 || listen(fd, 128) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct Connection {
+    int fd;
+    std::string in, out;
+};
+
+// Answers from the workers, waiting for the poll loop to move them onto
+// their connections' output buffers.
+class Outbox {
+public:
+    void post(AnalysisPool::Replies &replies) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &r : replies) {
+                std::string &buffer = pending[r.first];
+                buffer += r.second;
+                buffer += '\n';
+            }
+        }
+        // One wakeup per batch, and none while the loop has not yet drained
+        // the last one.
+        if (!signalled.exchange(true)) {
+            char c = 1;
+            if (write(wakePipe[1], &c, 1) < 0) {}
+        }
+    }
+
+    void take(std::map<uint64_t, std::string> &out) {
+        signalled = false;
+        std::lock_guard<std::mutex> lock(mutex);
+        out.swap(pending);
+    }
+
+private:
+    std::mutex mutex;
+    std::map<uint64_t, std::string> pending;
+    std::atomic<bool> signalled{false};
+};
+
+bool flush(Connection &c) {
+    while (!c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        c.out.erase(0, size_t(n));
+    }
+    return true;
+}
+
+// Splits what arrived into lines and submits them. False if the client
+// closed the connection or sent a line too long to be a request.
+bool receive(uint64_t id, Connection &c, AnalysisPool &pool) {
+    char buffer[16384];
+    for (;;) {
+        ssize_t n = recv(c.fd, buffer, sizeof buffer, 0);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            break;
+        }
+        c.in.append(buffer, size_t(n));
+    }
+    size_t start = 0, end;
+    while ((end = c.in.find('\n', start)) != std::string::npos) {
+        std::string line = c.in.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) pool.submit(id, line);
+        start = end + 1;
+    }
+    c.in.erase(0, start);
+    return c.in.size() <= MAX_LINE;
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::string socketPath;
+    int port = 0, workers = std::max(2u, std::thread::hardware_concurrency()), hashMb = DEFAULT_HASH_MB;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if (arg == "--port" && hasValue) port = std::atoi(argv[++i]);
+        else if (arg == "--workers" && hasValue) workers = std::max(2, std::atoi(argv[++i]));
+        else if (arg == "--hash" && hasValue) hashMb = std::max(1, std::atoi(argv[++i]));
+        else { usage(); return 2; }
+    }
+    if (!port && socketPath.empty()) socketPath = DEFAULT_SOCKET;
+
+    int listener = port ? listenTcp(port) : listenUnix(socketPath);
+    if (listener < 0) {
+        std::fprintf(stderr, "cannot listen on %s: %s\n", port ? ("port " + std::to_string(port)).c_str()
+                     : socketPath.c_str(), std::strerror(errno));
+        return 1;
+    }
+    setNonBlocking(listener);
+    if (pipe(wakePipe) < 0) return 1;
+    setNonBlocking(wakePipe[0]);
+    setNonBlocking(wakePipe[1]);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    Outbox outbox;
+    AnalysisPool pool(workers, size_t(hashMb), [&outbox](AnalysisPool::Replies &r) { outbox.post(r); });
+    std::printf("listening on %s, %d workers, %d MB hash\n",
+                port ? ("127.0.0.1:" + std::to_string(port)).c_str() : socketPath.c_str(), workers, hashMb);
+    std::fflush(stdout);
+
+    std::map<uint64_t, Connection> connections;
+    std::map<uint64_t, std::string> ready;
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> ids;
+    uint64_t nextId = 1;
+    while (!stopRequested) {
+        fds.clear();
+        ids.clear();
+        fds.push_back(pollfd{listener, POLLIN, 0});
+        fds.push_back(pollfd{wakePipe[0], POLLIN, 0});
+        for (auto &entry : connections) {
+            short events = POLLIN | (entry.second.out.empty() ? 0 : POLLOUT);
+            fds.push_back(pollfd{entry.second.fd, events, 0});
+            ids.push_back(entry.first);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) break;
+
+        if (fds[1].revents & POLLIN) {
+            char drain[256];
+            while (read(wakePipe[0], drain, sizeof drain) > 0) {}
+            outbox.take(ready);
+            for (auto &r : ready) {
+                auto it = connections.find(r.first);
+                if (it != connections.end()) it->second.out += r.second;
+            }
+            ready.clear();
+        }
+
+        std::vector<uint64_t> closing;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            auto it = connections.find(ids[i]);
+            Connection &c = it->second;
+            short revents = fds[i + 2].revents;
+            bool alive = true;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) alive = receive(ids[i], c, pool);
+            if (alive) alive = flush(c);
+            if (!alive) closing.push_back(ids[i]);
+        }
+        for (uint64_t id : closing) {
+            close(connections[id].fd);
+            connections.erase(id);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, NULL, NULL)) >= 0) {
+                setNonBlocking(fd);
+                if (port) {
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+                }
+                connections[nextId++] = Connection{fd, std::string(), std::string()};
+            }
+        }
+    }
+
+    std::printf("%s\n", pool.statsJson(0).c_str());
+    pool.shutdown();
+    for (auto &entry : connections) close(entry.second.fd);
+    close(listener);
+    if (!port) unlink(socketPath.c_str());
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "service.h"
+
+#include <chrono>
+
+SearchService::SearchService(Notifier n) : notify(n) {
+    tt.resize(32);
+    worker = std::thread(&SearchService::run, this);
+}
+
+SearchService::~SearchService() {
+    shutdown();
+}
+
+void SearchService::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (quit) return;
+        quit = true;
+        if (current) {
+            current->cancelled = true;
+            current->stop = true;
+        }
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+bool SearchService::resizeHash(size_t mb) {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return !running && !pending; });
+    return tt.resize(mb);
+}
+
+void SearchService::clearHash() {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return !running && !pending; });
+    tt.clear();
+}
+
+uint64_t SearchService::start(const GameState &g, const SearchLimits &limits, bool ponder,
+                              const IterationCallback &onIteration) {
+    std::unique_ptr<Request> r(new Request);
+    r->position = g;
+    r->limits = limits;
+    r->onIteration = onIteration;
+    r->token = std::make_shared<SearchToken>();
+    r->token->ponder = ponder;
+    r->limits.stop = &r->token->stop;
+    r->limits.ponder = ponder ? &r->token->ponder : nullptr;
+
+    SearchCompletion dropped;
+    bool droppedPending = false;
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) {
+            current->cancelled = true;
+            current->stop = true;
+        }
+        // A request that never started is completed here as cancelled.
+        if (pending) {
+            dropped.id = pending->id;
+            dropped.cancelled = true;
+            droppedPending = true;
+        }
+        id = r->id = nextId++;
+        current = r->token;
+        pending = std::move(r);
+    }
+    if (droppedPending) complete(dropped);
+    wake.notify_all();
+    return id;
+}
+
+void SearchService::ponderHit() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) current->ponder = false;
+    }
+    wake.notify_all();
+}
+
+void SearchService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) current->stop = true;
+    }
+    wake.notify_all();
+}
+
+void SearchService::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current) {
+            current->cancelled = true;
+            current->stop = true;
+        }
+    }
+    wake.notify_all();
+}
+
+bool SearchService::busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running || pending;
+}
+
+bool SearchService::poll(SearchCompletion &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (completions.empty()) return false;
+    out = std::move(completions.front());
+    completions.pop_front();
+    return true;
+}
+
+bool SearchService::waitCompletion(SearchCompletion &out, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!finished.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return !completions.empty(); }))
+        return false;
+    out = std::move(completions.front());
+    completions.pop_front();
+    return true;
+}
+
+void SearchService::complete(SearchCompletion &c) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        completions.push_back(std::move(c));
+    }
+    finished.notify_all();
+    if (notify) notify();
+}
+
+void SearchService::run() {
+    for (;;) {
+        std::unique_ptr<Request> r;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || pending; });
+            if (quit) break;
+            r = std::move(pending);
+            running = true;
+        }
+
+        SearchCompletion c;
+        c.id = r->id;
+        c.result = search(r->position, r->limits, tt, r->onIteration);
+
+        // A ponder search that ran out of depth still answers only after the
+        // ponder hit, as the opponent has not moved yet.
+        SearchToken &token = *r->token;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || token.stop || !token.ponder; });
+            c.cancelled = token.cancelled;
+            completions.push_back(std::move(c));
+            running = false;
+        }
+        finished.notify_all();
+        if (notify) notify();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    finished.notify_all();
+}
@@ -0,0 +1,84 @@
+#ifndef CHESS_SERVICE_H
+#define CHESS_SERVICE_H
+
+#include "search.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Cancellation token shared by a request and the search running it.
+struct SearchToken {
+    std::atomic<bool> stop{false};         // end the search, keep its result
+    std::atomic<bool> cancelled{false};    // the result is no longer wanted
+    std::atomic<bool> ponder{false};       // searching on the opponent's time
+};
+
+struct SearchCompletion {
+    uint64_t id = 0;
+    bool cancelled = false;    // superseded or cancelled; result may be empty
+    SearchResult result;
+};
+
+// Runs searches on one worker thread so callers never block. Each start()
+// supersedes whatever is queued or running. Finished requests, cancelled
+// ones included, go to a completion queue; the notifier runs after each push,
+// normally on the worker thread, so it must only signal (the GUI posts a
+// message to its window and polls from there).
+class SearchService {
+public:
+    typedef std::function<void()> Notifier;
+
+    explicit SearchService(Notifier notify = Notifier());
+    ~SearchService();
+    SearchService(const SearchService &) = delete;
+    SearchService &operator=(const SearchService &) = delete;
+
+    bool resizeHash(size_t mb);    // both wait for the current search to end
+    void clearHash();
+
+    // Returns the request id echoed in its completion. A ponder request holds
+    // off its limits until ponderHit(), and is not completed before then
+    // even if it reaches its depth. onIteration runs on the worker thread.
+    uint64_t start(const GameState &g, const SearchLimits &limits, bool ponder = false,
+                   const IterationCallback &onIteration = IterationCallback());
+    void ponderHit();
+    void stop();      // finish the current request early with its best move so far
+    void cancel();    // drop the current request
+
+    bool busy() const;
+    bool poll(SearchCompletion &out);
+    bool waitCompletion(SearchCompletion &out, int timeoutMs);
+    void shutdown();
+
+private:
+    struct Request {
+        uint64_t id = 0;
+        GameState position;
+        SearchLimits limits;
+        IterationCallback onIteration;
+        std::shared_ptr<SearchToken> token;
+    };
+
+    void run();
+    void complete(SearchCompletion &c);
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;        // new request, ponder hit, stop or shutdown
+    std::condition_variable finished;    // a completion was queued or the worker went idle
+    std::deque<SearchCompletion> completions;
+    std::unique_ptr<Request> pending;
+    std::shared_ptr<SearchToken> current;    // token of the newest request, queued or running
+    bool running = false;
+    bool quit = false;
+    uint64_t nextId = 1;
+    TranspositionTable tt;
+    Notifier notify;
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "session.h"
+
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(CompactGame) == 64, "CompactGame should fill one cache line");
+
+namespace {
+
+const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Four-bit piece codes: 0 is empty, then white PNBRQK from 1 and black from 9.
+const char CODE_PIECES[16] = {'.', 'P', 'N', 'B', 'R', 'Q', 'K', '.', '.', 'p', 'n', 'b', 'r', 'q', 'k', '.'};
+
+inline uint8_t pieceCode(char p) {
+    return p == '.' ? 0 : uint8_t(1 + pieceTypeOf(p) + (isBlackPiece(p) ? 8 : 0));
+}
+
+const size_t SLAB_BYTES = 64 * 1024;
+const int SHARD_BITS = 8;
+
+inline int classOf(uint32_t handle) { return int(handle >> 28); }
+inline uint32_t indexOf(uint32_t handle) { return (handle & 0x0FFFFFFF) - 1; }
+inline size_t blockBytes(int cls) { return size_t(16) << cls; }
+inline size_t blocksPerSlab(int cls) { return std::max<size_t>(1, SLAB_BYTES / blockBytes(cls)); }
+
+// A thread's working copy for the rules code; its vectors keep their
+// capacity from one call to the next.
+GameState &scratchState() {
+    thread_local GameState g;
+    return g;
+}
+
+bool matchMove(const MoveList &list, int sx, int sy, int tx, int ty, PieceType promotion, Move &out) {
+    for (const Move &m : list) {
+        if (m.sx != sx || m.sy != sy || m.tx != tx || m.ty != ty) continue;
+        if (m.kind == MOVE_PROMOTION && m.promotion != promotion) continue;
+        out = m;
+        return true;
+    }
+    return false;
+}
+
+}
+
+const char *gameStatusName(GameStatus status) {
+    switch (status) {
+        case GAME_CHECKMATE: return "checkmate";
+        case GAME_STALEMATE: return "stalemate";
+        case GAME_FIFTY_MOVES: return "fifty-move rule";
+        case GAME_REPETITION: return "threefold repetition";
+        case GAME_INSUFFICIENT_MATERIAL: return "insufficient material";
+        default: return "ongoing";
+    }
+}
+
+// The same order checkGameEnd reports them in.
+GameStatus gameStatus(const GameState &g) {
+    MoveList list;
+    if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list))
+        return isInCheck(g, g.whiteTurn) ? GAME_CHECKMATE : GAME_STALEMATE;
+    if (g.halfmoveClock >= 100) return GAME_FIFTY_MOVES;
+    if (repetitionCount(g) >= 2) return GAME_REPETITION;
+    if (isInsufficientMaterial(g.pos)) return GAME_INSUFFICIENT_MATERIAL;
+    return GAME_ONGOING;
+}
+
+void packGame(const GameState &g, CompactGame &c) {
+    for (int sq = 0; sq < 64; sq += 2)
+        c.squares[sq / 2] = uint8_t(pieceCode(g.board[squareY(sq)][squareX(sq)])
+                                    | pieceCode(g.board[squareY(sq)][squareX(sq) + 1]) << 4);
+    c.hash = g.hash;
+    c.moveCount = uint16_t(g.moveCount);
+    c.psqMg = int16_t(g.psq.mg);
+    c.psqEg = int16_t(g.psq.eg);
+    c.phase = uint8_t(g.phase);
+    c.castlingRights = uint8_t(g.castlingRights);
+    c.epSquare = int8_t(g.epSquare);
+    c.halfmoveClock = uint8_t(std::min(g.halfmoveClock, 255));
+    c.whiteTurn = g.whiteTurn;
+}
+
+void unpackGame(const CompactGame &c, GameState &g) {
+    g.pos.clear();
+    for (int sq = 0; sq < 64; ++sq) {
+        char p = CODE_PIECES[(c.squares[sq / 2] >> (sq & 1) * 4) & 15];
+        g.board[squareY(sq)][squareX(sq)] = p;
+        if (p != '.') g.pos.put(sq, p);
+    }
+    g.hash = c.hash;
+    g.moveCount = c.moveCount;
+    g.psq.mg = c.psqMg;
+    g.psq.eg = c.psqEg;
+    g.phase = c.phase;
+    g.castlingRights = c.castlingRights;
+    g.epSquare = c.epSquare;
+    g.halfmoveClock = c.halfmoveClock;
+    g.whiteTurn = c.whiteTurn;
+    g.gameOver = c.status != GAME_ONGOING;
+    g.nnue = nullptr;
+    g.nnueStack.clear();
+    g.legalCache.valid = false;
+    g.moveStack.clear();
+    g.keys.clear();
+}
+
+uint32_t BlockPool::allocate(size_t bytes) {
+    int cls = 0;
+    while (cls < CLASSES && blockBytes(cls) < bytes) ++cls;
+    if (cls == CLASSES) return 0;
+    SizeClass &sc = classes[cls];
+    uint32_t index;
+    if (!sc.freeList.empty()) {
+        index = sc.freeList.back();
+        sc.freeList.pop_back();
+    } else {
+        index = sc.next++;
+        size_t perSlab = blocksPerSlab(cls);
+        if (index / perSlab >= sc.slabs.size())
+            sc.slabs.emplace_back(new char[perSlab * blockBytes(cls)]);
+    }
+    ++sc.used;
+    return uint32_t(cls) << 28 | (index + 1);
+}
+
+void BlockPool::release(uint32_t handle) {
+    if (!handle) return;
+    SizeClass &sc = classes[classOf(handle)];
+    sc.freeList.push_back(indexOf(handle));
+    --sc.used;
+}
+
+void *BlockPool::data(uint32_t handle) const {
+    if (!handle) return nullptr;
+    int cls = classOf(handle);
+    uint32_t index = indexOf(handle);
+    size_t perSlab = blocksPerSlab(cls);
+    return classes[cls].slabs[index / perSlab].get() + index % perSlab * blockBytes(cls);
+}
+
+size_t BlockPool::capacity(uint32_t handle) {
+    return handle ? blockBytes(classOf(handle)) : 0;
+}
+
+size_t BlockPool::reservedBytes() const {
+    size_t total = sizeof *this;
+    for (int cls = 0; cls < CLASSES; ++cls) {
+        const SizeClass &sc = classes[cls];
+        total += sc.slabs.size() * blocksPerSlab(cls) * blockBytes(cls);
+        total += sc.slabs.capacity() * sizeof(sc.slabs[0]) + sc.freeList.capacity() * sizeof(uint32_t);
+    }
+    return total;
+}
+
+size_t BlockPool::usedBytes() const {
+    size_t total = 0;
+    for (int cls = 0; cls < CLASSES; ++cls) total += classes[cls].used * blockBytes(cls);
+    return total;
+}
+
+SessionHost::SessionHost(int shardCount) {
+    shardCount = std::max(1, std::min(shardCount, 1 << SHARD_BITS));
+    for (int i = 0; i < shardCount; ++i) shards.emplace_back(new Shard);
+}
+
+SessionId SessionHost::open() {
+    return open(START_FEN);
+}
+
+SessionId SessionHost::open(const std::string &fen) {
+    GameState &g = scratchState();
+    g.nnue = nullptr;
+    if (!loadFen(g, fen)) return 0;
+    return add(g);
+}
+
+SessionId SessionHost::add(const GameState &g) {
+    size_t shard = nextShard++ % shards.size();
+    Shard &s = *shards[shard];
+
+    CompactGame c;
+    std::memset(&c, 0, sizeof c);
+    packGame(g, c);
+    c.status = gameStatus(g);
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    uint32_t slot;
+    if (!s.freeSlots.empty()) {
+        slot = s.freeSlots.back();
+        s.freeSlots.pop_back();
+        s.games[slot] = c;
+    } else {
+        slot = uint32_t(s.games.size());
+        s.games.push_back(c);
+        s.generations.push_back(0);
+    }
+    uint32_t generation = ++s.generations[slot];
+    ++s.open;
+    return SessionId(generation) << 32 | uint64_t(slot) << SHARD_BITS | shard;
+}
+
+SessionHost::Shard &SessionHost::shardOf(SessionId id) const {
+    return *shards[(id & ((1u << SHARD_BITS) - 1)) % shards.size()];
+}
+
+CompactGame *SessionHost::find(Shard &s, SessionId id) const {
+    uint32_t slot = uint32_t(id) >> SHARD_BITS;
+    uint32_t generation = uint32_t(id >> 32);
+    if (slot >= s.games.size() || s.generations[slot] != generation || !(generation & 1)) return nullptr;
+    return &s.games[slot];
+}
+
+bool SessionHost::close(SessionId id) {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    CompactGame *c = find(s, id);
+    if (!c) return false;
+    s.pool.release(c->moves);
+    s.pool.release(c->keys);
+    uint32_t slot = uint32_t(id) >> SHARD_BITS;
+    ++s.generations[slot];
+    s.freeSlots.push_back(slot);
+    --s.open;
+    return true;
+}
+
+// Called with the shard locked and g unpacked from c.
+PlayResult SessionHost::apply(Shard &s, CompactGame &c, GameState &g, const Move &m) {
+    // Blocks double as they fill. The fifty-move rule keeps a game far
+    // below the largest size class and the key list below 101 entries.
+    if ((c.plies + 1u) * sizeof(PackedMove) > BlockPool::capacity(c.moves)) {
+        uint32_t grown = s.pool.allocate((c.plies + 1u) * sizeof(PackedMove) * 2);
+        if (c.plies) std::memcpy(s.pool.data(grown), s.pool.data(c.moves), c.plies * sizeof(PackedMove));
+        s.pool.release(c.moves);
+        c.moves = grown;
+    }
+    if ((c.keyCount + 1u) * sizeof(uint64_t) > BlockPool::capacity(c.keys)) {
+        uint32_t grown = s.pool.allocate((c.keyCount + 1u) * sizeof(uint64_t) * 2);
+        if (c.keyCount) std::memcpy(s.pool.data(grown), s.pool.data(c.keys), c.keyCount * sizeof(uint64_t));
+        s.pool.release(c.keys);
+        c.keys = grown;
+    }
+
+    makeMove(g, m);
+    static_cast<PackedMove *>(s.pool.data(c.moves))[c.plies++] = packMove(m);
+    if (g.halfmoveClock == 0) c.keyCount = 0;
+    else static_cast<uint64_t *>(s.pool.data(c.keys))[c.keyCount++] = g.keys.back();
+    packGame(g, c);
+    c.status = gameStatus(g);
+    return PLAY_OK;
+}
+
+PlayResult SessionHost::play(SessionId id, const Move &m) {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    CompactGame *c = find(s, id);
+    if (!c) return PLAY_NO_SESSION;
+    if (c->status != GAME_ONGOING) return PLAY_GAME_OVER;
+    GameState &g = scratchState();
+    unpackGame(*c, g);
+    const uint64_t *keys = static_cast<const uint64_t *>(s.pool.data(c->keys));
+    g.keys.assign(keys, keys + c->keyCount);
+    MoveList list;
+    Move legal;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+    if (!matchMove(list, m.sx, m.sy, m.tx, m.ty, m.promotion, legal)) return PLAY_ILLEGAL;
+    return apply(s, *c, g, legal);
+}
+
+PlayResult SessionHost::play(SessionId id, const std::string &move) {
+    if (move.size() < 4 || move.size() > 5) return PLAY_ILLEGAL;
+    Move m{move[0] - 'a', '8' - move[1], move[2] - 'a', '8' - move[3], MOVE_NORMAL, QUEEN};
+    if (!isInside(m.sx, m.sy) || !isInside(m.tx, m.ty)) return PLAY_ILLEGAL;
+    if (move.size() == 5) {
+        m.promotion = pieceTypeOf(move[4]);
+        if (m.promotion == PAWN || m.promotion == KING || m.promotion == NO_PIECE_TYPE) return PLAY_ILLEGAL;
+    }
+    return play(id, m);
+}
+
+bool SessionHost::legalMoves(SessionId id, MoveList &out) const {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    const CompactGame *c = find(s, id);
+    if (!c) return false;
+    GameState &g = scratchState();
+    unpackGame(*c, g);
+    out.count = 0;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, out);
+    return true;
+}
+
+bool SessionHost::status(SessionId id, GameStatus &out) const {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    const CompactGame *c = find(s, id);
+    if (!c) return false;
+    out = GameStatus(c->status);
+    return true;
+}
+
+bool SessionHost::position(SessionId id, GameState &out) const {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    const CompactGame *c = find(s, id);
+    if (!c) return false;
+    unpackGame(*c, out);
+    const uint64_t *keys = static_cast<const uint64_t *>(s.pool.data(c->keys));
+    out.keys.assign(keys, keys + c->keyCount);
+    out.selX = out.selY = -1;
+    out.lastMoveFromX = out.lastMoveFromY = out.lastMoveToX = out.lastMoveToY = -1;
+    clearLegalMoves(out);
+    return true;
+}
+
+bool SessionHost::record(SessionId id, std::vector<PackedMove> &out) const {
+    Shard &s = shardOf(id);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    const CompactGame *c = find(s, id);
+    if (!c) return false;
+    const PackedMove *moves = static_cast<const PackedMove *>(s.pool.data(c->moves));
+    out.assign(moves, moves + c->plies);
+    return true;
+}
+
+size_t SessionHost::sessionCount() const {
+    size_t total = 0;
+    for (const auto &s : shards) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        total += s->open;
+    }
+    return total;
+}
+
+size_t SessionHost::memoryUsage() const {
+    size_t total = sizeof *this + shards.capacity() * sizeof(shards[0]);
+    for (const auto &s : shards) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        total += sizeof(Shard) + s->games.capacity() * sizeof(CompactGame)
+               + (s->generations.capacity() + s->freeSlots.capacity()) * sizeof(uint32_t) + s->pool.reservedBytes();
+    }
+    return total;
+}
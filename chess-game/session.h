@@ -0,0 +1,124 @@
+#ifndef CHESS_SESSION_H
+#define CHESS_SESSION_H
+
+#include "movegen.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One game as a host keeps thousands of them: the board at four bits a
+// square and the state makeMove needs, in a single cache line. The move
+// record and the keys the repetition rule looks at live in the host's
+// block pool; the game only holds their handles.
+struct CompactGame {
+    uint8_t squares[32];    // piece codes, two squares a byte, a8 first
+    uint64_t hash;
+    uint32_t moves;         // pool block of PackedMoves, every ply since the session opened
+    uint32_t keys;          // pool block of keys since the last irreversible move
+    uint16_t plies;         // moves in the record
+    uint16_t moveCount;     // as GameState::moveCount
+    int16_t psqMg, psqEg;
+    uint8_t keyCount;
+    uint8_t phase;
+    uint8_t castlingRights;
+    int8_t epSquare;
+    uint8_t halfmoveClock;    // saturates at 255; the game ends at 100
+    uint8_t whiteTurn;
+    uint8_t status;           // GameStatus
+};
+
+enum GameStatus : uint8_t {
+    GAME_ONGOING,
+    GAME_CHECKMATE,
+    GAME_STALEMATE,
+    GAME_FIFTY_MOVES,
+    GAME_REPETITION,
+    GAME_INSUFFICIENT_MATERIAL
+};
+
+const char *gameStatusName(GameStatus status);
+GameStatus gameStatus(const GameState &g);
+
+// The board and state only; the keys and record handles are left alone.
+void packGame(const GameState &g, CompactGame &c);
+// Everything but the move stack and keys, which the caller fills.
+void unpackGame(const CompactGame &c, GameState &g);
+
+// Fixed-size blocks in power-of-two size classes from 16 bytes up, carved
+// out of slabs that are never freed or moved, so a handle stays valid
+// until it is released. Not thread-safe.
+class BlockPool {
+public:
+    static const int CLASSES = 16;
+
+    uint32_t allocate(size_t bytes);    // 0 if too large
+    void release(uint32_t handle);
+    void *data(uint32_t handle) const;
+    static size_t capacity(uint32_t handle);    // bytes, 0 for the null handle
+    size_t reservedBytes() const;               // slabs plus bookkeeping
+    size_t usedBytes() const;                   // blocks handed out
+
+private:
+    struct SizeClass {
+        std::vector<std::unique_ptr<char[]>> slabs;
+        std::vector<uint32_t> freeList;
+        uint32_t next = 0;    // blocks carved so far
+        uint32_t used = 0;
+    };
+    SizeClass classes[CLASSES];
+};
+
+typedef uint64_t SessionId;    // slot and generation; 0 is never issued
+
+enum PlayResult { PLAY_OK, PLAY_NO_SESSION, PLAY_GAME_OVER, PLAY_ILLEGAL };
+
+// Many independent games in one process. Sessions are spread over shards,
+// each with its own lock, slot table and pool, so threads playing in
+// different shards never contend. A session id names a slot and the
+// generation it was opened in; ids of closed sessions stay invalid after
+// the slot is reused.
+class SessionHost {
+public:
+    explicit SessionHost(int shards = 64);
+    SessionHost(const SessionHost &) = delete;
+    SessionHost &operator=(const SessionHost &) = delete;
+
+    SessionId open();    // the starting position
+    SessionId open(const std::string &fen);    // 0 if the FEN is invalid
+    bool close(SessionId id);
+
+    PlayResult play(SessionId id, const Move &m);
+    PlayResult play(SessionId id, const std::string &move);    // long algebraic, as UCI sends it
+    bool legalMoves(SessionId id, MoveList &out) const;    // replaces what out held
+    bool status(SessionId id, GameStatus &out) const;
+    // The current position with its repetition keys; the move stack is empty.
+    bool position(SessionId id, GameState &out) const;
+    bool record(SessionId id, std::vector<PackedMove> &out) const;
+
+    size_t sessionCount() const;
+    size_t memoryUsage() const;    // slot tables and pools, bytes reserved
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<CompactGame> games;
+        std::vector<uint32_t> generations;    // odd while the slot is open
+        std::vector<uint32_t> freeSlots;
+        BlockPool pool;
+        size_t open = 0;
+    };
+
+    SessionId add(const GameState &g);
+    Shard &shardOf(SessionId id) const;
+    CompactGame *find(Shard &s, SessionId id) const;
+    PlayResult apply(Shard &s, CompactGame &c, GameState &g, const Move &m);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<uint32_t> nextShard{0};    // new sessions go round the shards
+};
+
+#endif
@@ -0,0 +1,961 @@
+#include "tablebase.h"
+#include "mappedfile.h"
+#include "movegen.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// The tables number squares a1 = 0 ... h8 = 63 and pieces as
+// color << 3 | (type + 1); everything in this file up to readEntry() uses
+// their conventions, not the board's.
+inline int fileOf(int s) { return s & 7; }
+inline int rankOf(int s) { return s >> 3; }
+constexpr int offDiagonal(int s) { return (s >> 3) - (s & 7); }    // > 0 above a1-h8, < 0 below
+inline int edgeDistance(int file) { return (std::min)(file, 7 - file); }
+
+inline int tbSquare(int sq) { return sq ^ 56; }
+inline int tbPiece(char p) { return (isBlackPiece(p) ? 8 : 0) | (pieceTypeOf(p) + 1); }
+
+inline uint32_t readLE16(const uint8_t *p) { return uint32_t(p[0]) | uint32_t(p[1]) << 8; }
+inline uint32_t readLE32(const uint8_t *p) { return readLE16(p) | readLE16(p + 2) << 16; }
+inline uint32_t readBE32(const uint8_t *p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+inline uint64_t readBE64(const uint8_t *p) { return uint64_t(readBE32(p)) << 32 | readBE32(p + 4); }
+
+// Index tables shared by all files, built at compile time.
+struct IndexTables {
+    int mapB1H1H7[64];         // squares below the a1-h8 diagonal to 0..27
+    int mapA1D1D4[64];         // the a1-d1-d4 triangle to 0..9, diagonal last
+    int mapKK[10][64];         // the 462 legal placements of two kings, the first in the triangle
+    uint64_t binomial[6][64];  // binomial[k][n] = n choose k
+    int mapPawns[64];          // a2-h7 to 0..47, higher towards the edges and the second rank
+    int leadPawnIdx[6][64];
+    int leadPawnsSize[6][4];
+};
+
+constexpr bool kingsTouch(int a, int b) {
+    int df = (a & 7) - (b & 7), dr = (a >> 3) - (b >> 3);
+    return df >= -1 && df <= 1 && dr >= -1 && dr <= 1;
+}
+
+constexpr IndexTables buildIndexTables() {
+    IndexTables t{};
+    int code = 0;
+    for (int s = 0; s < 64; ++s)
+        if (offDiagonal(s) < 0) t.mapB1H1H7[s] = code++;
+
+    const int D4 = 27;
+    code = 0;
+    for (int s = 0; s <= D4; ++s)
+        if (offDiagonal(s) < 0 && (s & 7) <= 3) t.mapA1D1D4[s] = code++;
+    for (int s = 0; s <= D4; ++s)
+        if (offDiagonal(s) == 0 && (s & 7) <= 3) t.mapA1D1D4[s] = code++;
+
+    // With the first king on the diagonal the second may not be above it;
+    // placements with both kings on the diagonal come last.
+    const int B1 = 1;
+    code = 0;
+    for (int pass = 0; pass < 2; ++pass)
+        for (int idx = 0; idx < 10; ++idx)
+            for (int s1 = 0; s1 <= D4; ++s1) {
+                if (t.mapA1D1D4[s1] != idx || (!idx && s1 != B1)) continue;
+                for (int s2 = 0; s2 < 64; ++s2) {
+                    if (kingsTouch(s1, s2)) continue;
+                    if (!offDiagonal(s1) && offDiagonal(s2) > 0) continue;
+                    bool bothOnDiagonal = !offDiagonal(s1) && !offDiagonal(s2);
+                    if (bothOnDiagonal == (pass == 1)) t.mapKK[idx][s2] = code++;
+                }
+            }
+
+    t.binomial[0][0] = 1;
+    for (int n = 1; n < 64; ++n)
+        for (int k = 0; k < 6 && k <= n; ++k)
+            t.binomial[k][n] = (k > 0 ? t.binomial[k - 1][n - 1] : 0) + (k < n ? t.binomial[k][n - 1] : 0);
+
+    int available = 47;
+    for (int leadPawns = 1; leadPawns <= 5; ++leadPawns)
+        for (int file = 0; file < 4; ++file) {
+            int idx = 0;
+            for (int rank = 1; rank <= 6; ++rank) {
+                int sq = rank * 8 + file;
+                if (leadPawns == 1) {
+                    t.mapPawns[sq] = available--;
+                    t.mapPawns[sq ^ 7] = available--;
+                }
+                t.leadPawnIdx[leadPawns][sq] = idx;
+                idx += int(t.binomial[leadPawns - 1][t.mapPawns[sq]]);
+            }
+            t.leadPawnsSize[leadPawns][file] = idx;
+        }
+    return t;
+}
+
+constexpr IndexTables INDEX = buildIndexTables();
+
+// The leading pawn is the one with the highest mapPawns value.
+inline bool pawnsLess(int a, int b) { return INDEX.mapPawns[a] < INDEX.mapPawns[b]; }
+
+enum PairsFlag { FLAG_STM = 1, FLAG_MAPPED = 2, FLAG_WIN_PLIES = 4, FLAG_LOSS_PLIES = 8, FLAG_WIDE = 16,
+                 FLAG_SINGLE_VALUE = 128 };
+
+// One compressed sub-table: a side to move and, with pawns, a leading pawn
+// file. Values are Huffman-coded symbols of a recursive-pairing grammar;
+// the pointers all point into the mapped file.
+struct PairsData {
+    int flags = 0;
+    size_t sizeofBlock = 0;
+    uint64_t span = 0;
+    uint32_t numBlocks = 0;
+    int maxSymLen = 0;
+    int minSymLen = 0;    // the value itself for FLAG_SINGLE_VALUE
+    const uint8_t *lowestSym = nullptr;
+    const uint8_t *btree = nullptr;       // 3 bytes per symbol: two 12-bit children
+    const uint8_t *blockLength = nullptr;
+    size_t blockLengthSize = 0;
+    const uint8_t *sparseIndex = nullptr;    // 6 bytes per entry: block, offset in block
+    size_t sparseIndexSize = 0;
+    const uint8_t *data = nullptr;
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;    // values a symbol expands to, minus one
+    int pieces[TB_MAX_PIECES] = {};
+    uint64_t groupIdx[TB_MAX_PIECES + 1] = {};
+    int groupLen[TB_MAX_PIECES + 1] = {};
+    uint16_t mapIdx[4] = {};
+};
+
+inline int btreeLeft(const PairsData &d, int s) {
+    const uint8_t *lr = d.btree + 3 * s;
+    return (lr[1] & 0xF) << 8 | lr[0];
+}
+
+inline int btreeRight(const PairsData &d, int s) {
+    const uint8_t *lr = d.btree + 3 * s;
+    return lr[2] << 4 | lr[1] >> 4;
+}
+
+bool setSymlen(PairsData &d, int s, std::vector<bool> &visited) {
+    visited[s] = true;
+    int right = btreeRight(d, s);
+    if (right == 0xFFF) return true;
+    int left = btreeLeft(d, s);
+    int n = int(d.symlen.size());
+    if (left >= n || right >= n) return false;
+    if (!visited[left] && !setSymlen(d, left, visited)) return false;
+    if (!visited[right] && !setSymlen(d, right, visited)) return false;
+    d.symlen[s] = uint8_t(d.symlen[left] + d.symlen[right] + 1);
+    return true;
+}
+
+// Reads the sizes and the Huffman code of one sub-table starting at base + at.
+bool setSizes(PairsData &d, const uint8_t *base, size_t &at, size_t size) {
+    if (at + 2 > size) return false;
+    d.flags = base[at++];
+    if (d.flags & FLAG_SINGLE_VALUE) {
+        d.minSymLen = base[at++];
+        return true;
+    }
+    if (at + 9 > size) return false;
+    int groups = 0;
+    while (d.groupLen[groups]) ++groups;
+    uint64_t tbSize = d.groupIdx[groups];
+    d.sizeofBlock = size_t(1) << base[at];
+    d.span = uint64_t(1) << base[at + 1];
+    d.sparseIndexSize = size_t((tbSize + d.span - 1) / d.span);
+    int padding = base[at + 2];
+    d.numBlocks = readLE32(base + at + 3);
+    d.blockLengthSize = d.numBlocks + padding;
+    d.maxSymLen = base[at + 7];
+    d.minSymLen = base[at + 8];
+    at += 9;
+    if (d.minSymLen < 1 || d.maxSymLen < d.minSymLen || d.maxSymLen > 32) return false;
+
+    // Canonical Huffman code: longer codes have lower values, so base64[len]
+    // is the lowest 64-bit left-aligned code of length minSymLen + len.
+    size_t lengths = size_t(d.maxSymLen - d.minSymLen + 1);
+    if (at + 2 * lengths + 2 > size) return false;
+    d.lowestSym = base + at;
+    d.base64.assign(lengths, 0);
+    for (int i = int(lengths) - 2; i >= 0; --i)
+        d.base64[i] = (d.base64[i + 1] + readLE16(d.lowestSym + 2 * i) - readLE16(d.lowestSym + 2 * (i + 1))) / 2;
+    for (size_t i = 0; i < lengths; ++i) d.base64[i] <<= 64 - i - d.minSymLen;
+    at += 2 * lengths;
+
+    size_t symbols = readLE16(base + at);
+    at += 2;
+    if (at + 3 * symbols > size) return false;
+    d.btree = base + at;
+    d.symlen.assign(symbols, 0);
+    std::vector<bool> visited(symbols);
+    for (size_t s = 0; s < symbols; ++s)
+        if (!visited[s] && !setSymlen(d, int(s), visited)) return false;
+    at += 3 * symbols + (symbols & 1);
+    return true;
+}
+
+int decompressPairs(const PairsData &d, uint64_t idx) {
+    if (d.flags & FLAG_SINGLE_VALUE) return d.minSymLen;
+
+    // The sparse index gives the block and offset of every span-th value,
+    // measured from the middle of the span; walk the block lengths from there.
+    uint32_t k = uint32_t(idx / d.span);
+    const uint8_t *sparse = d.sparseIndex + 6 * size_t(k);
+    uint32_t block = readLE32(sparse);
+    int offset = int(readLE16(sparse + 4)) + int(idx % d.span) - int(d.span / 2);
+    while (offset < 0) offset += int(readLE16(d.blockLength + 2 * size_t(--block))) + 1;
+    while (offset > int(readLE16(d.blockLength + 2 * size_t(block))))
+        offset -= int(readLE16(d.blockLength + 2 * size_t(block++))) + 1;
+
+    // Skip whole symbols until the one covering offset.
+    const uint8_t *ptr = d.data + uint64_t(block) * d.sizeofBlock;
+    uint64_t buf64 = readBE64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+    for (;;) {
+        int len = 0;
+        while (buf64 < d.base64[len]) ++len;
+        sym = int((buf64 - d.base64[len]) >> (64 - len - d.minSymLen));
+        sym = (sym + int(readLE16(d.lowestSym + 2 * len))) & 0xFFFF;
+        if (offset < d.symlen[sym] + 1) break;
+        offset -= d.symlen[sym] + 1;
+        len += d.minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= uint64_t(readBE32(ptr)) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // Then descend the pair tree to the value itself.
+    while (d.symlen[sym]) {
+        int left = btreeLeft(d, sym);
+        if (offset < d.symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d.symlen[left] + 1;
+            sym = btreeRight(d, sym);
+        }
+    }
+    return btreeLeft(d, sym);
+}
+
+inline int sign(int v) { return (v > 0) - (v < 0); }
+
+int dtzBeforeZeroing(TBResult wdl) {
+    switch (wdl) {
+        case TB_WIN: return 1;
+        case TB_CURSED_WIN: return 101;
+        case TB_BLESSED_LOSS: return -101;
+        case TB_LOSS: return -1;
+        default: return 0;
+    }
+}
+
+// Piece counts without the kings, four bits each, white's in the low half.
+uint64_t materialKey(const int white[6], const int black[6]) {
+    uint64_t key = 0;
+    for (int pt = PAWN; pt < KING; ++pt)
+        key |= uint64_t(white[pt]) << (4 * pt) | uint64_t(black[pt]) << (20 + 4 * pt);
+    return key;
+}
+
+uint64_t materialKey(const Position &pos) {
+    int counts[2][6];
+    for (int c = 0; c < 2; ++c)
+        for (int pt = PAWN; pt <= KING; ++pt) counts[c][pt] = popcount(pos.pieces[c][pt]);
+    return materialKey(counts[WHITE], counts[BLACK]);
+}
+
+// "KRPvKR" into piece counts, white being the left side.
+bool parseTableName(const std::string &name, int counts[2][6]) {
+    std::memset(counts, 0, sizeof(int) * 12);
+    int side = 0, pieces = 0;
+    for (char ch : name) {
+        if (ch == 'v') {
+            if (++side > 1) return false;
+            continue;
+        }
+        PieceType pt = pieceTypeOf(ch);
+        if (pt == NO_PIECE_TYPE || !isWhitePiece(ch)) return false;
+        ++counts[side][pt];
+        ++pieces;
+    }
+    return side == 1 && counts[0][KING] == 1 && counts[1][KING] == 1 && pieces <= TB_MAX_PIECES;
+}
+
+void listDirectory(const std::string &dir, std::vector<std::string> &names) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA((dir + "\\*").c_str(), &found);
+    if (h == INVALID_HANDLE_VALUE) return;
+    do {
+        if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) names.push_back(found.cFileName);
+    } while (FindNextFileA(h, &found));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir.c_str());
+    if (!d) return;
+    while (dirent *e = readdir(d)) names.push_back(e->d_name);
+    closedir(d);
+#endif
+}
+
+bool endsWith(const std::string &s, const char *suffix) {
+    size_t n = std::strlen(suffix);
+    return s.size() > n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+struct ProbeTimer {
+    TBStats *stats;
+    Clock::time_point start;
+
+    explicit ProbeTimer(TBStats *s) : stats(s) {
+        if (stats) start = Clock::now();
+    }
+    bool done(bool hit) {
+        if (stats) {
+            stats->probes++;
+            stats->hits += hit;
+            stats->seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        return hit;
+    }
+};
+
+bool isCheckmate(const GameState &g) {
+    return isInCheck(g, g.whiteTurn) && !hasLegalMoves(g, g.whiteTurn);
+}
+
+enum MappingState { MAPPING_NONE, MAPPING_READY, MAPPING_EVICTING, MAPPING_BROKEN };
+
+}
+
+// One .rtbw or .rtbz file. A prober counts itself in users while it reads
+// the mapping; eviction marks the file first and backs off if it then sees
+// a user, and a prober that sees the mark backs off to the locked path, so
+// a mapping is never pulled from under a reader.
+struct Tablebases::TableFile {
+    std::string path;    // empty when the file is missing
+    std::atomic<int> state{MAPPING_NONE};
+    std::atomic<int> users{0};
+    std::atomic<bool> referenced{false};    // probed since the eviction sweep last passed
+    MappedFile file;
+    PairsData items[2][4];    // [side to move][leading pawn file]; DTZ files store one side
+    const uint8_t *dtzMap = nullptr;
+};
+
+// A material combination, named with the stronger side as white.
+struct Tablebases::Table {
+    uint64_t key = 0;     // material with the named sides
+    uint64_t key2 = 0;    // and with the colors swapped
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;    // some piece besides the kings appears only once
+    int pawnCount[2] = {0, 0};       // leading color first
+    TableFile wdl;
+    TableFile dtz;
+};
+
+
+namespace {
+
+// Splits the pieces into the groups the index is built from and works out
+// how many placements each group has. The groups are multiplied in the
+// order the file gives, not the order of pieces[].
+bool setGroups(PairsData &d, const int order[2], int file, int pieceCount, bool hasPawns, bool hasUniquePieces,
+               bool bothSidesPawns) {
+    int n = 0, firstLen = hasPawns ? 0 : hasUniquePieces ? 3 : 2;
+    d.groupLen[n] = 1;
+    for (int i = 1; i < pieceCount; ++i) {
+        if (--firstLen > 0 || d.pieces[i] == d.pieces[i - 1]) {
+            if (++d.groupLen[n] > 5) return false;
+        } else {
+            d.groupLen[++n] = 1;
+        }
+    }
+    d.groupLen[++n] = 0;
+
+    int next = bothSidesPawns ? 2 : 1;
+    int freeSquares = 64 - d.groupLen[0] - (bothSidesPawns ? d.groupLen[1] : 0);
+    uint64_t idx = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+        if (k == order[0]) {
+            d.groupIdx[0] = idx;
+            idx *= hasPawns ? INDEX.leadPawnsSize[d.groupLen[0]][file] : hasUniquePieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d.groupIdx[1] = idx;
+            idx *= INDEX.binomial[d.groupLen[1]][48 - d.groupLen[0]];
+        } else {
+            d.groupIdx[next] = idx;
+            idx *= INDEX.binomial[d.groupLen[next]][freeSquares];
+            freeSquares -= d.groupLen[next++];
+        }
+    }
+    d.groupIdx[n] = idx;
+    return true;
+}
+
+// DTZ files store moves or plies per sub-table and may remap the values
+// through a small table per result; this returns plies plus one.
+int mapDtz(const PairsData &d, const uint8_t *map, int value, TBResult wdl) {
+    static const int WDL_MAP[] = {1, 3, 0, 2, 0};
+    if (d.flags & FLAG_MAPPED) {
+        size_t i = size_t(d.mapIdx[WDL_MAP[wdl + 2]]) + value;
+        value = (d.flags & FLAG_WIDE) ? int(readLE16(map + 2 * i)) : map[i];
+    }
+    if ((wdl == TB_WIN && !(d.flags & FLAG_WIN_PLIES)) || (wdl == TB_LOSS && !(d.flags & FLAG_LOSS_PLIES))
+        || wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)
+        value *= 2;
+    return value + 1;
+}
+
+// Orders root moves: wins within the fifty-move rule first and fastest,
+// then cursed wins, draws, blessed losses, and losses, slowest first.
+int rootRank(int dtz, int halfmoveClock) {
+    if (dtz > 0) return dtz + halfmoveClock <= 100 ? 30000 - dtz : 20000 - dtz;
+    if (dtz < 0) return -dtz + halfmoveClock <= 100 ? -30000 - dtz : -20000 - dtz;
+    return 0;
+}
+
+TBResult rankResult(int rank) {
+    if (rank >= 25000) return TB_WIN;
+    if (rank > 0) return TB_CURSED_WIN;
+    if (rank == 0) return TB_DRAW;
+    if (rank > -25000) return TB_BLESSED_LOSS;
+    return TB_LOSS;
+}
+
+bool isZeroing(const GameState &g, const Move &m) {
+    return m.kind == MOVE_EN_PASSANT || g.board[m.ty][m.tx] != '.' || pieceTypeOf(g.board[m.sy][m.sx]) == PAWN;
+}
+
+bool isCapture(const GameState &g, const Move &m) {
+    return m.kind == MOVE_EN_PASSANT || g.board[m.ty][m.tx] != '.';
+}
+
+}
+
+Tablebases::Tablebases() = default;
+
+Tablebases::~Tablebases() {
+    clear();
+}
+
+int Tablebases::init(const std::string &paths, int maxOpenFiles) {
+    clear();
+    maxOpen = (std::max)(2, maxOpenFiles);
+
+#ifdef _WIN32
+    const char separator = ';', slash = '\\';
+#else
+    const char separator = ':', slash = '/';
+#endif
+    // Table name to WDL and DTZ path; the first directory listing a file wins.
+    std::map<std::string, std::pair<std::string, std::string>> found;
+    size_t start = 0;
+    while (start <= paths.size()) {
+        size_t end = paths.find(separator, start);
+        if (end == std::string::npos) end = paths.size();
+        std::string dir = paths.substr(start, end - start);
+        start = end + 1;
+        if (dir.empty()) continue;
+        std::vector<std::string> names;
+        listDirectory(dir, names);
+        for (const std::string &name : names) {
+            bool wdl = endsWith(name, ".rtbw");
+            if (!wdl && !endsWith(name, ".rtbz")) continue;
+            std::pair<std::string, std::string> &entry = found[name.substr(0, name.size() - 5)];
+            std::string &path = wdl ? entry.first : entry.second;
+            if (path.empty()) path = dir + slash + name;
+        }
+    }
+
+    for (const auto &entry : found) {
+        int counts[2][6];
+        if (entry.second.first.empty() || !parseTableName(entry.first, counts)) continue;
+        std::unique_ptr<Table> t(new Table);
+        t->key = materialKey(counts[WHITE], counts[BLACK]);
+        t->key2 = materialKey(counts[BLACK], counts[WHITE]);
+        if (byMaterial.count(t->key) || byMaterial.count(t->key2)) continue;
+        for (int c = 0; c < 2; ++c)
+            for (int pt = PAWN; pt <= KING; ++pt) {
+                t->pieceCount += counts[c][pt];
+                if (pt != KING && counts[c][pt] == 1) t->hasUniquePieces = true;
+            }
+        int whitePawns = counts[WHITE][PAWN], blackPawns = counts[BLACK][PAWN];
+        t->hasPawns = whitePawns + blackPawns > 0;
+        bool whiteLeads = !blackPawns || (whitePawns && blackPawns >= whitePawns);
+        t->pawnCount[0] = whiteLeads ? whitePawns : blackPawns;
+        t->pawnCount[1] = whiteLeads ? blackPawns : whitePawns;
+        t->wdl.path = entry.second.first;
+        t->dtz.path = entry.second.second;
+
+        byMaterial[t->key] = t.get();
+        byMaterial[t->key2] = t.get();
+        files.push_back(&t->wdl);
+        if (!t->dtz.path.empty()) files.push_back(&t->dtz);
+        largest = (std::max)(largest, t->pieceCount);
+        tables.push_back(std::move(t));
+    }
+    return int(tables.size());
+}
+
+void Tablebases::clear() {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    files.clear();
+    byMaterial.clear();
+    tables.clear();    // unmaps whatever is still mapped
+    largest = 0;
+    open = 0;
+    clockHand = 0;
+}
+
+bool Tablebases::covers(const GameState &g) const {
+    return !tables.empty() && g.castlingRights == 0 && popcount(g.pos.occupied) <= largest;
+}
+
+int Tablebases::openFiles() const {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    return open;
+}
+
+uint64_t Tablebases::filesMapped() const {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    return mappedTotal;
+}
+
+uint64_t Tablebases::filesEvicted() const {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    return evictedTotal;
+}
+
+bool Tablebases::acquire(TableFile &f, const Table &t, bool dtz) {
+    if (f.path.empty()) return false;
+    f.users.fetch_add(1);
+    if (f.state.load() == MAPPING_READY) {
+        if (!f.referenced.load(std::memory_order_relaxed)) f.referenced.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    f.users.fetch_sub(1);
+    if (f.state.load() == MAPPING_BROKEN) return false;
+
+    std::lock_guard<std::mutex> lock(mapMutex);
+    int state = f.state.load();
+    if (state == MAPPING_NONE) {
+        while (open >= maxOpen && evictOne()) {}
+        if (!mapFile(f, t, dtz)) {
+            f.state.store(MAPPING_BROKEN);
+            return false;
+        }
+        ++open;
+        ++mappedTotal;
+        f.referenced.store(true, std::memory_order_relaxed);
+        f.state.store(MAPPING_READY);
+    } else if (state != MAPPING_READY) {
+        return false;
+    }
+    f.users.fetch_add(1);
+    return true;
+}
+
+void Tablebases::release(TableFile &f) {
+    f.users.fetch_sub(1);
+}
+
+// Clock sweep: a file probed since the hand last passed gets another lap.
+// Called with mapMutex held.
+bool Tablebases::evictOne() {
+    size_t n = files.size();
+    for (size_t step = 0; step < 2 * n; ++step) {
+        TableFile &f = *files[clockHand];
+        clockHand = (clockHand + 1) % n;
+        if (f.state.load() != MAPPING_READY) continue;
+        if (f.referenced.exchange(false, std::memory_order_relaxed)) continue;
+        f.state.store(MAPPING_EVICTING);
+        if (f.users.load() != 0) {
+            f.state.store(MAPPING_READY);
+            continue;
+        }
+        f.file.close();
+        for (auto &side : f.items)
+            for (PairsData &d : side) d = PairsData();
+        f.dtzMap = nullptr;
+        f.state.store(MAPPING_NONE);
+        --open;
+        ++evictedTotal;
+        return true;
+    }
+    return false;
+}
+
+// Maps the file and points every sub-table at its part of it. Called with
+// mapMutex held.
+bool Tablebases::mapFile(TableFile &f, const Table &t, bool dtz) {
+    static const uint8_t WDL_MAGIC[] = {0x71, 0xE8, 0x23, 0x5D};
+    static const uint8_t DTZ_MAGIC[] = {0xD7, 0x66, 0x0C, 0xA5};
+    const int HAS_PAWNS = 2;
+
+    if (!f.file.open(f.path)) return false;
+    const uint8_t *base = f.file.data();
+    size_t size = f.file.size();
+    auto fail = [&f]() {
+        f.file.close();
+        for (auto &side : f.items)
+            for (PairsData &d : side) d = PairsData();
+        f.dtzMap = nullptr;
+        return false;
+    };
+    if (size % 64 != 16 || std::memcmp(base, dtz ? DTZ_MAGIC : WDL_MAGIC, 4) != 0) return fail();
+    if (bool(base[4] & HAS_PAWNS) != t.hasPawns) return fail();
+
+    size_t at = 5;
+    int sides = !dtz && t.key != t.key2 ? 2 : 1;
+    int maxFile = t.hasPawns ? 3 : 0;
+    bool bothSidesPawns = t.hasPawns && t.pawnCount[1];
+    for (int file = 0; file <= maxFile; ++file) {
+        if (at + 1 + bothSidesPawns + t.pieceCount > size) return fail();
+        int order[2][2] = {{base[at] & 0xF, bothSidesPawns ? base[at + 1] & 0xF : 0xF},
+                           {base[at] >> 4, bothSidesPawns ? base[at + 1] >> 4 : 0xF}};
+        at += 1 + bothSidesPawns;
+        for (int k = 0; k < t.pieceCount; ++k, ++at)
+            for (int i = 0; i < sides; ++i) f.items[i][file].pieces[k] = i ? base[at] >> 4 : base[at] & 0xF;
+        for (int i = 0; i < sides; ++i)
+            if (!setGroups(f.items[i][file], order[i], file, t.pieceCount, t.hasPawns, t.hasUniquePieces,
+                           bothSidesPawns))
+                return fail();
+    }
+    at += at & 1;
+
+    for (int file = 0; file <= maxFile; ++file)
+        for (int i = 0; i < sides; ++i)
+            if (!setSizes(f.items[i][file], base, at, size)) return fail();
+
+    if (dtz) {
+        size_t mapStart = at;
+        f.dtzMap = base + at;
+        for (int file = 0; file <= maxFile; ++file) {
+            PairsData &d = f.items[0][file];
+            if (!(d.flags & FLAG_MAPPED)) continue;
+            if (d.flags & FLAG_WIDE) at += at & 1;
+            for (int i = 0; i < 4; ++i) {
+                if (at + 2 > size) return fail();
+                if (d.flags & FLAG_WIDE) {
+                    d.mapIdx[i] = uint16_t((at - mapStart) / 2 + 1);
+                    at += 2 * size_t(readLE16(base + at)) + 2;
+                } else {
+                    d.mapIdx[i] = uint16_t(at - mapStart + 1);
+                    at += size_t(base[at]) + 1;
+                }
+            }
+        }
+        at += at & 1;
+    }
+
+    for (int file = 0; file <= maxFile; ++file)
+        for (int i = 0; i < sides; ++i) {
+            f.items[i][file].sparseIndex = base + at;
+            at += 6 * f.items[i][file].sparseIndexSize;
+        }
+    for (int file = 0; file <= maxFile; ++file)
+        for (int i = 0; i < sides; ++i) {
+            f.items[i][file].blockLength = base + at;
+            at += 2 * f.items[i][file].blockLengthSize;
+        }
+    for (int file = 0; file <= maxFile; ++file)
+        for (int i = 0; i < sides; ++i) {
+            at = (at + 63) & ~size_t(63);
+            f.items[i][file].data = base + at;
+            at += size_t(f.items[i][file].numBlocks) * f.items[i][file].sizeofBlock;
+        }
+    if (at > size) return fail();
+    return true;
+}
+
+// The value stored for g: the WDL score, or the DTZ in plies plus one. The
+// table is named with the stronger side as white, so a position with black
+// stronger (or a symmetric one with black to move) is looked up with the
+// colors swapped and the board turned over.
+int Tablebases::readEntry(const Table &t, const TableFile &f, const GameState &g, uint64_t material, bool dtz,
+                          TBResult wdl, ProbeState &state) const {
+    int squares[TB_MAX_PIECES] = {}, pieces[TB_MAX_PIECES] = {};
+    int size = 0, leadPawnsCount = 0, tbFile = 0;
+    Bitboard leadPawns = 0;
+
+    bool blackToMove = !g.whiteTurn;
+    bool flip = (t.key == t.key2 && blackToMove) || material != t.key;
+    int flipColor = flip ? 8 : 0, flipSquares = flip ? 56 : 0;
+    int stm = flip ^ blackToMove;
+
+    // Pawn tables are split by the file of the leading pawn, the one nearest
+    // the edge and then the second rank; all pawns of its color come first.
+    if (t.hasPawns) {
+        int color = (f.items[0][0].pieces[0] ^ flipColor) >> 3;
+        leadPawns = g.pos.pieces[color][PAWN];
+        for (Bitboard b = leadPawns; b;) squares[size++] = tbSquare(popLsb(b)) ^ flipSquares;
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + size, pawnsLess));
+        tbFile = edgeDistance(fileOf(squares[0]));
+    }
+
+    // DTZ files hold one side to move; the caller searches a ply for the other.
+    if (dtz && (f.items[0][tbFile].flags & FLAG_STM) != stm && !(t.key == t.key2 && !t.hasPawns)) {
+        state = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    for (Bitboard b = g.pos.occupied & ~leadPawns; b;) {
+        int sq = popLsb(b);
+        squares[size] = tbSquare(sq) ^ flipSquares;
+        pieces[size++] = tbPiece(g.board[squareY(sq)][squareX(sq)]) ^ flipColor;
+    }
+    const PairsData &d = f.items[dtz ? 0 : stm][tbFile];
+
+    // Put the pieces in the order the file encodes them.
+    for (int i = leadPawnsCount; i < size - 1; ++i)
+        for (int j = i + 1; j < size; ++j)
+            if (d.pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    if (fileOf(squares[0]) > 3)
+        for (int i = 0; i < size; ++i) squares[i] ^= 7;
+
+    uint64_t idx;
+    if (t.hasPawns) {
+        idx = INDEX.leadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsLess);
+        for (int i = 1; i < leadPawnsCount; ++i) idx += INDEX.binomial[i][INDEX.mapPawns[squares[i]]];
+    } else {
+        // Without pawns the leading piece goes into the a1-d1-d4 triangle,
+        // and the first of its group off the diagonal below it.
+        if (rankOf(squares[0]) > 3)
+            for (int i = 0; i < size; ++i) squares[i] ^= 56;
+        for (int i = 0; i < d.groupLen[0]; ++i) {
+            if (!offDiagonal(squares[i])) continue;
+            if (offDiagonal(squares[i]) > 0)
+                for (int j = i; j < size; ++j) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if (t.hasUniquePieces) {
+            // The first three pieces together: 31332 placements.
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offDiagonal(squares[0]))
+                idx = (INDEX.mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            else if (offDiagonal(squares[1]))
+                idx = (6 * 63 + rankOf(squares[0]) * 28 + INDEX.mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            else if (offDiagonal(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28
+                    + (rankOf(squares[1]) - adjust1) * 28 + INDEX.mapB1H1H7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6
+                    + (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+        } else {
+            idx = INDEX.mapKK[INDEX.mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The other groups as combinations of the squares left over, each
+    // square numbered past the ones the earlier groups took.
+    idx *= d.groupIdx[0];
+    int *groupSq = squares + d.groupLen[0];
+    bool remainingPawns = t.hasPawns && t.pawnCount[1];
+    for (int next = 1; d.groupLen[next]; ++next) {
+        std::stable_sort(groupSq, groupSq + d.groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d.groupLen[next]; ++i) {
+            int adjust = int(std::count_if(squares, groupSq, [&](int s) { return groupSq[i] > s; }));
+            n += INDEX.binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d.groupIdx[next];
+        groupSq += d.groupLen[next];
+    }
+
+    int value = decompressPairs(d, idx);
+    return dtz ? mapDtz(d, f.dtzMap, value, wdl) : value - 2;
+}
+
+int Tablebases::probeTable(GameState &g, bool dtz, TBResult wdl, ProbeState &state) {
+    if (popcount(g.pos.occupied) == 2) return 0;    // KvK
+    uint64_t material = materialKey(g.pos);
+    auto it = byMaterial.find(material);
+    if (it == byMaterial.end()) {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    Table &t = *it->second;
+    TableFile &f = dtz ? t.dtz : t.wdl;
+    if (!acquire(f, t, dtz)) {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    int value = readEntry(t, f, g, material, dtz, wdl, state);
+    release(f);
+    return value;
+}
+
+// The tables hold no positions with en passant rights and may hold "don't
+// care" values where a capture is best, so captures (and with checkZeroing
+// pawn moves) are searched out first. state becomes
+// PROBE_ZEROING_BEST_MOVE when one of those is the best move.
+TBResult Tablebases::searchWdl(GameState &g, bool checkZeroing, ProbeState &state) {
+    MoveList moves;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, moves);
+    if (moves.empty()) {
+        state = PROBE_ZEROING_BEST_MOVE;
+        return isInCheck(g, g.whiteTurn) ? TB_LOSS : TB_DRAW;
+    }
+
+    TBResult best = TB_LOSS;
+    int tried = 0;
+    for (const Move &m : moves) {
+        if (!isCapture(g, m) && (!checkZeroing || pieceTypeOf(g.board[m.sy][m.sx]) != PAWN)) continue;
+        ++tried;
+        makeMove(g, m);
+        TBResult value = TBResult(-searchWdl(g, false, state));
+        undoMove(g);
+        if (state == PROBE_FAIL) return TB_DRAW;
+        if (value > best) {
+            best = value;
+            if (value >= TB_WIN) {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    bool noMoreMoves = tried == moves.size();
+    TBResult value = best;
+    if (!noMoreMoves) {
+        value = TBResult(probeTable(g, false, TB_DRAW, state));
+        if (state == PROBE_FAIL) return TB_DRAW;
+    }
+    if (best >= value) {
+        state = best > TB_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return best;
+    }
+    state = PROBE_OK;
+    return value;
+}
+
+int Tablebases::searchDtz(GameState &g, ProbeState &state) {
+    state = PROBE_OK;
+    TBResult wdl = searchWdl(g, true, state);
+    if (state == PROBE_FAIL || wdl == TB_DRAW) return 0;
+    if (state == PROBE_ZEROING_BEST_MOVE) return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(g, true, wdl, state);
+    if (state == PROBE_FAIL) return 0;
+    if (state != PROBE_CHANGE_STM)
+        return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * sign(wdl);
+
+    // The file holds the other side to move: take the best reply, counting
+    // a zeroing move as the distance before it.
+    MoveList moves;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, moves);
+    int minDtz = 0xFFFF;
+    for (const Move &m : moves) {
+        bool zeroing = isZeroing(g, m);
+        makeMove(g, m);
+        dtz = zeroing ? -dtzBeforeZeroing(searchWdl(g, false, state)) : -searchDtz(g, state);
+        if (dtz == 1 && isCheckmate(g)) minDtz = 1;
+        if (!zeroing) dtz += sign(dtz);
+        if (dtz < minDtz && sign(dtz) == sign(wdl)) minDtz = dtz;
+        undoMove(g);
+        if (state == PROBE_FAIL) return 0;
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+bool Tablebases::lookupWdl(GameState &g, TBResult &out) {
+    ProbeState state = PROBE_OK;
+    TBResult wdl = searchWdl(g, false, state);
+    if (state == PROBE_FAIL) return false;
+    out = wdl;
+    return true;
+}
+
+bool Tablebases::lookupDtz(GameState &g, int &out) {
+    ProbeState state = PROBE_OK;
+    int dtz = searchDtz(g, state);
+    if (state == PROBE_FAIL) return false;
+    out = dtz;
+    return true;
+}
+
+bool Tablebases::probeWdl(GameState &g, TBResult &out, TBStats *stats) {
+    ProbeTimer timer(stats);
+    return timer.done(covers(g) && lookupWdl(g, out));
+}
+
+bool Tablebases::probeDtz(GameState &g, int &dtz, TBStats *stats) {
+    ProbeTimer timer(stats);
+    return timer.done(covers(g) && lookupDtz(g, dtz));
+}
+
+bool Tablebases::probeOutcome(GameState &g, TBResult &out, TBStats *stats) {
+    ProbeTimer timer(stats);
+    TBResult wdl;
+    if (!covers(g) || !lookupWdl(g, wdl)) return timer.done(false);
+    if ((wdl == TB_WIN || wdl == TB_LOSS) && g.halfmoveClock > 0) {
+        int dtz;
+        if (!lookupDtz(g, dtz)) return timer.done(false);
+        if (std::abs(dtz) + g.halfmoveClock > 100) wdl = wdl == TB_WIN ? TB_CURSED_WIN : TB_BLESSED_LOSS;
+    }
+    out = wdl;
+    return timer.done(true);
+}
+
+bool Tablebases::probeRoot(GameState &g, Move &best, TBResult &result, int &dtz, TBStats *stats) {
+    ProbeTimer timer(stats);
+    if (!covers(g)) return timer.done(false);
+    MoveList moves;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, moves);
+    if (moves.empty() || !lookupDtz(g, dtz)) return timer.done(false);
+
+    int bestRank = INT_MIN;
+    for (const Move &m : moves) {
+        bool zeroing = isZeroing(g, m);
+        makeMove(g, m);
+        ProbeState state = PROBE_OK;
+        int d;
+        if (zeroing) {
+            d = dtzBeforeZeroing(TBResult(-searchWdl(g, false, state)));
+        } else {
+            d = -searchDtz(g, state);
+            d += sign(d);
+        }
+        if (d == 2 && isCheckmate(g)) d = 1;
+        undoMove(g);
+        if (state == PROBE_FAIL) return timer.done(false);
+        int rank = rootRank(d, zeroing ? 0 : g.halfmoveClock);
+        if (rank > bestRank) {
+            bestRank = rank;
+            best = m;
+        }
+    }
+    result = rankResult(bestRank);
+    return timer.done(true);
+}
@@ -0,0 +1,104 @@
+#ifndef CHESS_TABLEBASE_H
+#define CHESS_TABLEBASE_H
+
+#include "rules.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Result with best play from the side to move's point of view. A cursed win
+// is a win on the board that the fifty-move rule turns into a draw; a
+// blessed loss is the other side of one.
+enum TBResult { TB_LOSS = -2, TB_BLESSED_LOSS = -1, TB_DRAW = 0, TB_CURSED_WIN = 1, TB_WIN = 2 };
+
+const int TB_MAX_PIECES = 7;
+const int TB_DEFAULT_OPEN_FILES = 64;
+
+// Probe counters live with the caller, one per search thread, as for the
+// transposition table.
+struct TBStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    double seconds = 0;    // time spent in probes, successful or not
+
+    double microsPerProbe() const { return probes ? seconds * 1e6 / probes : 0.0; }
+};
+
+// Syzygy WDL (.rtbw) and DTZ (.rtbz) tables read from local directories.
+// init() only records which tables exist; a file is memory-mapped the first
+// time a probe needs it, and once maxOpenFiles are mapped the least recently
+// used idle one is unmapped to make room. Probes may run concurrently from
+// any number of threads; init() and clear() may not.
+//
+// Probes play moves on g to resolve captures and en passant, and leave it
+// as they found it. Positions with castling rights are never in a table.
+class Tablebases {
+public:
+    Tablebases();
+    ~Tablebases();
+    Tablebases(const Tablebases &) = delete;
+    Tablebases &operator=(const Tablebases &) = delete;
+
+    // paths lists directories separated by ';' on Windows and ':' elsewhere.
+    // Returns the number of WDL tables found.
+    int init(const std::string &paths, int maxOpenFiles = TB_DEFAULT_OPEN_FILES);
+    void clear();
+
+    int tableCount() const { return int(tables.size()); }
+    int maxPieces() const { return largest; }
+    // Cheap test for whether a probe can succeed at all.
+    bool covers(const GameState &g) const;
+
+    // Result assuming the halfmove clock was just reset.
+    bool probeWdl(GameState &g, TBResult &out, TBStats *stats = nullptr);
+    // Plies to the next capture or pawn move (or mate) with best play,
+    // negative when losing, beyond +-100 for cursed wins and blessed losses,
+    // 0 for a draw. It may be one ply longer than the real distance.
+    bool probeDtz(GameState &g, int &dtz, TBStats *stats = nullptr);
+    // The result with the current halfmove clock taken into account, for
+    // adjudicating games.
+    bool probeOutcome(GameState &g, TBResult &out, TBStats *stats = nullptr);
+    // The move that keeps the best result within the fifty-move rule while
+    // zeroing the clock soonest (or, when losing, latest). result and dtz
+    // describe the root.
+    bool probeRoot(GameState &g, Move &best, TBResult &result, int &dtz, TBStats *stats = nullptr);
+
+    int openFiles() const;
+    uint64_t filesMapped() const;     // lifetime totals
+    uint64_t filesEvicted() const;
+
+private:
+    struct Table;
+    struct TableFile;
+    enum ProbeState { PROBE_FAIL, PROBE_OK, PROBE_CHANGE_STM, PROBE_ZEROING_BEST_MOVE };
+
+    bool acquire(TableFile &f, const Table &t, bool dtz);
+    void release(TableFile &f);
+    bool mapFile(TableFile &f, const Table &t, bool dtz);
+    bool evictOne();
+    int probeTable(GameState &g, bool dtz, TBResult wdl, ProbeState &state);
+    TBResult searchWdl(GameState &g, bool checkZeroing, ProbeState &state);
+    int searchDtz(GameState &g, ProbeState &state);
+    int readEntry(const Table &t, const TableFile &f, const GameState &g, uint64_t material, bool dtz,
+                  TBResult wdl, ProbeState &state) const;
+    bool lookupWdl(GameState &g, TBResult &out);
+    bool lookupDtz(GameState &g, int &out);
+
+    std::vector<std::unique_ptr<Table>> tables;
+    std::unordered_map<uint64_t, Table *> byMaterial;
+    std::vector<TableFile *> files;    // every registered file, for the eviction sweep
+    int largest = 0;
+    int maxOpen = TB_DEFAULT_OPEN_FILES;
+
+    mutable std::mutex mapMutex;    // guards mapping, unmapping and the counters below
+    int open = 0;
+    size_t clockHand = 0;
+    uint64_t mappedTotal = 0;
+    uint64_t evictedTotal = 0;
+};
+
+#endif
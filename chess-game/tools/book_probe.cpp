@@ -0,0 +1,112 @@
+#include "book.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+static const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// The reference positions from the Polyglot book format description.
+static const struct {
+    const char *moves;
+    uint64_t key;
+} REFERENCE_KEYS[] = {
+    {"", 0x463b96181691fc9cull},
+    {"e2e4", 0x823c9b50fd114196ull},
+    {"e2e4 d7d5", 0x0756b94461c50fb0ull},
+    {"e2e4 d7d5 e4e5", 0x662fafb965db29d4ull},
+    {"e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78ull},
+    {"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652a607ca3f242c1ull},
+    {"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00fdd303c946bdd9ull},
+    {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3c8123ea7b067637ull},
+    {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5c3f9b829b279560ull},
+};
+
+static void usage() {
+    std::printf("usage: book-probe BOOK [--fen FEN] [--moves \"e2e4 e7e5 ...\"] [--iterations N]\n"
+                "       book-probe --check-keys\n");
+}
+
+static bool playMoves(GameState &g, const std::string &moves) {
+    std::istringstream in(moves);
+    std::string text;
+    while (in >> text) {
+        Move m;
+        if (!parseMove(g, text, m)) {
+            std::fprintf(stderr, "illegal move: %s\n", text.c_str());
+            return false;
+        }
+        makeMove(g, m);
+    }
+    return true;
+}
+
+static int checkKeys() {
+    int failures = 0;
+    for (const auto &ref : REFERENCE_KEYS) {
+        GameState g;
+        loadFen(g, START_FEN);
+        if (!playMoves(g, ref.moves)) return 1;
+        uint64_t key = polyglotKey(g);
+        bool ok = key == ref.key;
+        failures += !ok;
+        std::printf("%-36s %016llx %s\n", *ref.moves ? ref.moves : "(start)", (unsigned long long)key,
+                    ok ? "ok" : "MISMATCH");
+    }
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && std::string(argv[1]) == "--check-keys") return checkKeys();
+    if (argc < 2 || argv[1][0] == '-') {
+        usage();
+        return 2;
+    }
+    std::string path = argv[1], fen = START_FEN, moves;
+    int iterations = 100000;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) fen = argv[++i];
+        else if (arg == "--moves" && hasValue) moves = argv[++i];
+        else if (arg == "--iterations" && hasValue) iterations = std::max(1, std::atoi(argv[++i]));
+        else { usage(); return 2; }
+    }
+
+    OpeningBook book;
+    if (!book.open(path)) {
+        std::fprintf(stderr, "cannot open book %s\n", path.c_str());
+        return 1;
+    }
+    GameState g;
+    if (!loadFen(g, fen)) {
+        std::fprintf(stderr, "invalid FEN: %s\n", fen.c_str());
+        return 1;
+    }
+    if (!playMoves(g, moves)) return 1;
+
+    std::printf("%s: %zu entries\n", path.c_str(), book.entryCount());
+    std::printf("key %016llx\n", (unsigned long long)polyglotKey(g));
+    BookMove found[MAX_BOOK_MOVES];
+    int n = book.lookup(g, found, MAX_BOOK_MOVES);
+    int total = 0;
+    for (int i = 0; i < n; ++i) total += found[i].weight;
+    for (int i = 0; i < n; ++i)
+        std::printf("  %-6s weight %5d  %5.1f%%\n", moveToString(found[i].move).c_str(), found[i].weight,
+                    total ? 100.0 * found[i].weight / total : 0.0);
+    if (n == 0) std::printf("  not in book\n");
+
+    // Time the full probe: key, binary search and move decoding.
+    auto t0 = std::chrono::steady_clock::now();
+    int hits = 0;
+    for (int i = 0; i < iterations; ++i) {
+        Move m;
+        hits += book.probe(g, m, BOOK_WEIGHTED, uint64_t(i) * 0x9E3779B97F4A7C15ull);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%d probes, %d hits, %.3f us/probe\n", iterations, hits, us / iterations);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "eval.h"
+#include "movegen.h"
+#include "search.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage() {
+    std::printf("usage: eval-bench [--plies N] [--repeat N] [--seed N]\n");
+}
+
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// Random games from each bench position; every position on the way is a
+// sample, so the set mixes openings, middlegames and endgames.
+static std::vector<GameState> samplePositions(int plies, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<GameState> samples;
+    for (const std::string &fen : benchPositions()) {
+        GameState g;
+        loadFen(g, fen);
+        for (int ply = 0; ply < plies; ++ply) {
+            MoveList list;
+            if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list)) break;
+            makeMove(g, list.moves[random() % list.count]);
+            samples.push_back(g);
+        }
+    }
+    return samples;
+}
+
+// The search pattern: make a move, evaluate, take it back.
+template <typename Eval>
+static double timeMakeEvalUndo(std::vector<GameState> &samples, int repeat, Eval eval, int64_t &sum, uint64_t &count) {
+    auto t0 = Clock::now();
+    for (int r = 0; r < repeat; ++r)
+        for (GameState &g : samples) {
+            MoveList list;
+            generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+            for (const Move &m : list) {
+                makeMove(g, m);
+                sum += eval(g);
+                undoMove(g);
+                ++count;
+            }
+        }
+    return secondsSince(t0);
+}
+
+int main(int argc, char **argv) {
+    int plies = 60, repeat = 20;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--plies" && hasValue) plies = std::atoi(argv[++i]);
+        else if (arg == "--repeat" && hasValue) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else { usage(); return 2; }
+    }
+
+    std::vector<GameState> samples = samplePositions(plies, seed);
+
+    // Agreement first: every sample and every position one move further.
+    uint64_t checked = 0, mismatches = 0;
+    for (GameState &g : samples) {
+        MoveList list;
+        generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+        for (int i = -1; i < list.count; ++i) {
+            if (i >= 0) makeMove(g, list.moves[i]);
+            ++checked;
+            if (evaluate(g) != evaluateFull(g)) {
+                if (++mismatches <= 10)
+                    std::printf("mismatch: %s  incremental %d  full %d\n", toFen(g).c_str(), evaluate(g),
+                                evaluateFull(g));
+            }
+            if (i >= 0) undoMove(g);
+        }
+    }
+    std::printf("%zu sampled positions, %llu checked, %llu mismatches\n", samples.size(),
+                (unsigned long long)checked, (unsigned long long)mismatches);
+
+    // Leaf cost alone: the same positions evaluated over and over.
+    int64_t sum = 0;
+    auto t0 = Clock::now();
+    for (int r = 0; r < repeat * 50; ++r)
+        for (const GameState &g : samples) sum += evaluate(g);
+    double incremental = secondsSince(t0);
+    t0 = Clock::now();
+    for (int r = 0; r < repeat * 50; ++r)
+        for (const GameState &g : samples) sum += evaluateFull(g);
+    double full = secondsSince(t0);
+    double evals = double(samples.size()) * repeat * 50;
+    std::printf("eval only        incremental %8.1f M/s  full %8.1f M/s  speedup %5.2fx\n",
+                evals / incremental / 1e6, evals / full / 1e6, full / incremental);
+
+    // With the cost of keeping the sums in makeMove/undoMove included.
+    uint64_t countIncremental = 0, countFull = 0;
+    double withMoveIncremental = timeMakeEvalUndo(samples, repeat, evaluate, sum, countIncremental);
+    double withMoveFull = timeMakeEvalUndo(samples, repeat, evaluateFull, sum, countFull);
+    std::printf("make/eval/undo   incremental %8.1f M/s  full %8.1f M/s  speedup %5.2fx\n",
+                countIncremental / withMoveIncremental / 1e6, countFull / withMoveFull / 1e6,
+                withMoveFull / withMoveIncremental);
+    std::printf("checksum %lld\n", (long long)sum);
+    return mismatches ? 1 : 0;
+}
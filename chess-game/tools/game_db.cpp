@@ -0,0 +1,168 @@
+#include "gamedb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static void usage() {
+    std::printf("usage: game-db --build PGN DB [--threads N] [--memory MB] [--max-ply N]\n"
+                "       game-db DB [--fen FEN] [--moves \"e2e4 e7e5 ...\"] [--games N] [--bench QUERIES]\n");
+}
+
+// Coordinate or SAN moves.
+static bool playMoves(GameState &g, const std::string &moves) {
+    std::istringstream in(moves);
+    std::string text;
+    while (in >> text) {
+        Move m;
+        if (!parseMove(g, text, m) && !parseSan(g, text.c_str(), text.size(), m)) {
+            std::fprintf(stderr, "illegal move: %s\n", text.c_str());
+            return false;
+        }
+        makeMove(g, m);
+    }
+    return true;
+}
+
+static std::string percentages(const DbResultCounts &c) {
+    char text[64];
+    double n = std::max<uint64_t>(c.games, 1) / 100.0;
+    std::snprintf(text, sizeof text, "%6.1f%% %6.1f%% %6.1f%%", c.whiteWins / n, c.draws / n, c.blackWins / n);
+    return text;
+}
+
+static int build(const std::string &pgn, const std::string &db, const DbBuildOptions &options) {
+    DbBuildStats stats;
+    std::string error;
+    bool ok = buildGameDatabase(pgn, db, options, stats, error);
+    for (const std::string &e : stats.errors) std::printf("skipped %s\n", e.c_str());
+    if (!ok) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double seconds = std::max(stats.seconds, 1e-9);
+    std::printf("%llu games (%llu skipped), %llu plies, %llu positions in %llu runs\n",
+                (unsigned long long)stats.games, (unsigned long long)stats.skipped, (unsigned long long)stats.plies,
+                (unsigned long long)stats.positions, (unsigned long long)stats.runs);
+    std::printf("%.2f s, %.0f games/s, %.0f positions/s, %.1f MB (%.1f bytes/game)\n", stats.seconds,
+                stats.games / seconds, stats.positions / seconds, stats.bytes / 1048576.0,
+                stats.games ? double(stats.bytes) / stats.games : 0.0);
+    return 0;
+}
+
+// Positions from random plies of random stored games, each looked up once.
+static void bench(const GameDatabase &db, int queries) {
+    std::mt19937_64 random(1);
+    std::vector<GameState> positions;
+    int damaged = 0;
+    for (int i = 0; i < queries && db.gameCount(); ++i) {
+        uint64_t id = random() % db.gameCount();
+        DbGame info;
+        db.game(id, info);
+        positions.emplace_back();
+        if (!db.replay(id, positions.back(), int(random() % (info.plies + 1)))) {
+            positions.pop_back();
+            ++damaged;
+        }
+    }
+    if (damaged) std::printf("DAMAGED: %d sampled games did not replay\n", damaged);
+    std::vector<double> micros;
+    std::vector<DbHit> hits;
+    uint64_t games = 0;
+    for (const GameState &g : positions) {
+        auto t0 = Clock::now();
+        games += db.find(g, hits, 10);
+        DbExplorer x = db.explore(g);
+        micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        if (x.total.games == 0) std::printf("MISSING: position not found\n");
+    }
+    if (micros.empty()) return;
+    std::sort(micros.begin(), micros.end());
+    std::printf("%zu queries, %.1f games each: p50 %.1f us  p99 %.1f us  max %.1f us\n", micros.size(),
+                double(games) / micros.size(), micros[micros.size() / 2], micros[micros.size() * 99 / 100],
+                micros.back());
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 4 && std::string(argv[1]) == "--build") {
+        DbBuildOptions options;
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 4; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--threads" && hasValue) options.threads = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--memory" && hasValue) options.sortMemory = size_t(std::max(1, std::atoi(argv[++i]))) << 20;
+            else if (arg == "--max-ply" && hasValue) options.maxIndexPly = std::max(0, std::atoi(argv[++i]));
+            else { usage(); return 2; }
+        }
+        return build(argv[2], argv[3], options);
+    }
+    if (argc < 2 || argv[1][0] == '-') {
+        usage();
+        return 2;
+    }
+    std::string path = argv[1], fen = START_FEN, moves;
+    int showGames = 10, benchQueries = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) fen = argv[++i];
+        else if (arg == "--moves" && hasValue) moves = argv[++i];
+        else if (arg == "--games" && hasValue) showGames = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--bench" && hasValue) benchQueries = std::max(1, std::atoi(argv[++i]));
+        else { usage(); return 2; }
+    }
+
+    GameDatabase db;
+    if (!db.open(path)) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+    std::printf("%s: %llu games, %llu positions\n", path.c_str(), (unsigned long long)db.gameCount(),
+                (unsigned long long)db.positionCount());
+    if (benchQueries) {
+        bench(db, benchQueries);
+        return 0;
+    }
+
+    GameState g;
+    if (!loadFen(g, fen)) {
+        std::fprintf(stderr, "invalid FEN\n");
+        return 1;
+    }
+    if (!playMoves(g, moves)) return 1;
+    auto t0 = Clock::now();
+    std::vector<DbHit> hits;
+    uint64_t reached = db.find(g, hits, size_t(showGames));
+    DbExplorer x = db.explore(g);
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+    std::printf("  %-8s %8s   %7s %7s %7s\n", "", "games", "1-0", "1/2", "0-1");
+    std::printf("  %-8s %8llu   %s\n", "(here)", (unsigned long long)reached, percentages(x.total).c_str());
+    for (const DbNextMove &next : x.moves) {
+        Move m = unpackMove(next.move), legal;
+        std::string text = findLegalMove(g, m.sx, m.sy, m.tx, m.ty, m.promotion, legal) ? moveToSan(g, legal)
+                                                                                          : moveToString(m);
+        std::printf("  %-8s %8llu   %s\n", text.c_str(), (unsigned long long)next.results.games,
+                    percentages(next.results).c_str());
+    }
+    for (const DbHit &hit : hits) {
+        DbGame info;
+        if (!db.game(hit.game, info)) continue;
+        std::printf("  #%-8u ply %-4d %-7s %s - %s, %s %s\n", hit.game, hit.ply, dbResultName(hit.result),
+                    dbTag(info.tags, "White").c_str(), dbTag(info.tags, "Black").c_str(),
+                    dbTag(info.tags, "Event").c_str(), dbTag(info.tags, "Date").c_str());
+    }
+    std::printf("query %.1f us\n", us);
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "navigator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef GameNavigator::NodeId NodeId;
+
+static void usage() {
+    std::printf("usage: nav-bench [--plies N] [--variations N] [--jumps N] [--interval N] [--seed N]\n");
+}
+
+static double microsSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+static void printPercentiles(const char *name, std::vector<double> &us) {
+    std::sort(us.begin(), us.end());
+    std::printf("%-22s %8zu  p50 %7.2f us  p99 %7.2f us  max %8.2f us\n", name, us.size(), us[us.size() / 2],
+                us[std::min(us.size() - 1, us.size() * 99 / 100)], us.back());
+}
+
+// Quiet piece moves where there are any, so nothing is captured, no pawn
+// locks up, and the game can go on for thousands of plies.
+static bool randomQuietMove(const GameState &g, std::mt19937_64 &random, Move &out) {
+    MoveList list;
+    if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list)) return false;
+    std::vector<Move> quiet;
+    for (const Move &m : list)
+        if (g.board[m.ty][m.tx] == '.' && pieceTypeOf(g.board[m.sy][m.sx]) != PAWN && m.kind == MOVE_NORMAL)
+            quiet.push_back(m);
+    out = quiet.empty() ? list.moves[random() % list.count] : quiet[random() % quiet.size()];
+    return true;
+}
+
+// The position at node, replayed from the start along its path.
+static GameState replayFromStart(const GameNavigator &nav, NodeId node) {
+    std::vector<PackedMove> moves;
+    for (; node != GameNavigator::ROOT; node = nav.parent(node)) moves.push_back(nav.move(node));
+    GameState g;
+    initBoard(g);
+    for (auto it = moves.rbegin(); it != moves.rend(); ++it) makeMove(g, unpackMove(*it));
+    return g;
+}
+
+// Repetitions only count before the fifty-move rule draws the game.
+static bool samePosition(const GameState &a, const GameState &b) {
+    return a.hash == b.hash && toFen(a) == toFen(b) && a.whiteCaptures == b.whiteCaptures
+        && a.blackCaptures == b.blackCaptures && (a.halfmoveClock >= 100 || repetitionCount(a) == repetitionCount(b));
+}
+
+int main(int argc, char **argv) {
+    int plies = 6000, variations = 300, jumps = 100000, interval = GameNavigator::DEFAULT_KEYFRAME_INTERVAL;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--plies" && hasValue) plies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--variations" && hasValue) variations = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--jumps" && hasValue) jumps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--interval" && hasValue) interval = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else { usage(); return 2; }
+    }
+    std::mt19937_64 random(seed);
+    GameNavigator nav(interval);
+
+    // The main line, then variations branching off it at random plies.
+    std::vector<double> playUs;
+    Move m;
+    for (int retries = 0; nav.ply() < plies && retries < 1000;) {
+        if (!randomQuietMove(nav.position(), random, m)) {
+            // Mated or stalemated: take the last move back and try another.
+            nav.remove(nav.current());
+            ++retries;
+            continue;
+        }
+        auto t0 = Clock::now();
+        nav.play(m);
+        playUs.push_back(microsSince(t0));
+    }
+    int mainLength = nav.ply();
+    for (int v = 0; v < variations; ++v) {
+        nav.jumpToPly(0);
+        nav.jumpToPly(int(random() % mainLength));
+        for (int n = 1 + int(random() % 12); n > 0 && randomQuietMove(nav.position(), random, m); --n) nav.play(m);
+    }
+    std::printf("%d-ply main line, %d variations: %zu nodes, %zu keyframes every %d plies\n", mainLength, variations,
+                nav.nodeCount(), nav.keyframeCount(), interval);
+    printPercentiles("play (with SAN)", playUs);
+
+    // Random jumps anywhere in the tree, some checked against a full replay.
+    std::vector<double> jumpUs;
+    uint64_t replayedBefore = nav.replayedMoves();
+    int failures = 0, checked = 0;
+    for (int i = 0; i < jumps; ++i) {
+        NodeId target = NodeId(random() % nav.nodeCount());
+        auto t0 = Clock::now();
+        nav.jump(target);
+        jumpUs.push_back(microsSince(t0));
+        if (i % 97 == 0) {
+            ++checked;
+            if (!samePosition(nav.position(), replayFromStart(nav, target))) ++failures;
+        }
+    }
+    printPercentiles("random jump", jumpUs);
+    std::printf("%-22s %.2f moves replayed per jump, %d of %d checked positions wrong\n", "",
+                double(nav.replayedMoves() - replayedBefore) / jumps, failures, checked);
+
+    // Stepping through the whole main line, as arrow keys would.
+    nav.jumpToPly(0);
+    nav.promote(nav.line().back());
+    std::vector<double> stepUs;
+    for (int ply = 0; ply < mainLength; ++ply) {
+        auto t0 = Clock::now();
+        nav.forward();
+        stepUs.push_back(microsSince(t0));
+    }
+    for (int ply = 0; ply < mainLength; ++ply) {
+        auto t0 = Clock::now();
+        nav.back();
+        stepUs.push_back(microsSince(t0));
+    }
+    printPercentiles("step forward/back", stepUs);
+    if (!samePosition(nav.position(), replayFromStart(nav, GameNavigator::ROOT))) ++failures;
+
+    // What the move list costs per move at the end of the game: the SAN of
+    // every ply regenerated, as the list did before, against the
+    // navigator's line with the text kept on its nodes.
+    nav.jumpToPly(mainLength);
+    GameState flat = replayFromStart(nav, nav.current());
+    auto t0 = Clock::now();
+    std::vector<std::string> history = sanHistory(flat);
+    double rebuildUs = microsSince(t0);
+    t0 = Clock::now();
+    std::vector<NodeId> line = nav.line();
+    size_t textBytes = 0;
+    for (NodeId n : line) textBytes += nav.san(n).size();
+    double lineUs = microsSince(t0);
+    bool sameText = history.size() == line.size();
+    for (size_t i = 0; sameText && i < line.size(); ++i) sameText = history[i] == nav.san(line[i]);
+    std::printf("move list at ply %d: sanHistory %.0f us, line + cached SAN %.1f us (%zu bytes), %s\n", mainLength,
+                rebuildUs, lineUs, textBytes, sameText ? "same text" : "TEXT DIFFERS");
+    return failures || !sameText ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include "eval.h"
+#include "movegen.h"
+#include "search.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage() {
+    std::printf("usage: nnue-bench [--net FILE] [--write FILE] [--plies N] [--repeat N] [--seed N]\n");
+}
+
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static std::vector<GameState> samplePositions(const NnueNetwork &net, int plies, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<GameState> samples;
+    for (const std::string &fen : benchPositions()) {
+        GameState g;
+        loadFen(g, fen);
+        for (int ply = 0; ply < plies; ++ply) {
+            MoveList list;
+            if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list)) break;
+            makeMove(g, list.moves[random() % list.count]);
+            samples.push_back(g);
+            setNnue(samples.back(), &net);
+        }
+    }
+    return samples;
+}
+
+static uint64_t accumulatorHash(const NnueAccumulator &acc) {
+    const unsigned char *bytes = (const unsigned char *)&acc;
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < sizeof acc; ++i) h = (h ^ bytes[i]) * 1099511628211ull;
+    return h;
+}
+
+// Every sample and every position one move further, with the accumulator
+// as makeMove left it.
+template <typename Visit>
+static void forEachChild(std::vector<GameState> &samples, Visit visit) {
+    for (GameState &g : samples) {
+        MoveList list;
+        generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+        for (int i = -1; i < list.count; ++i) {
+            if (i >= 0) makeMove(g, list.moves[i]);
+            visit(g);
+            if (i >= 0) undoMove(g);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string netPath, writePath;
+    int plies = 60, repeat = 10;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--net" && hasValue) netPath = argv[++i];
+        else if (arg == "--write" && hasValue) writePath = argv[++i];
+        else if (arg == "--plies" && hasValue) plies = std::atoi(argv[++i]);
+        else if (arg == "--repeat" && hasValue) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else { usage(); return 2; }
+    }
+
+    NnueNetwork net;
+    if (netPath.empty()) {
+        net.randomize(seed);
+        std::printf("random network, seed %llu\n", (unsigned long long)seed);
+    } else if (!net.load(netPath)) {
+        std::fprintf(stderr, "cannot load network %s\n", netPath.c_str());
+        return 1;
+    }
+    if (!writePath.empty()) {
+        NnueNetwork copy;
+        if (!net.save(writePath) || !copy.load(writePath)) {
+            std::fprintf(stderr, "cannot write network %s\n", writePath.c_str());
+            return 1;
+        }
+        net = copy;
+        std::printf("wrote %s and read it back\n", writePath.c_str());
+    }
+
+    std::vector<NnueBackend> backends;
+    for (NnueBackend b : {NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2})
+        if (nnueBackendSupported(b)) backends.push_back(b);
+    NnueBackend best = nnueBackend();
+
+    // The scalar kernels from scratch are the reference: every backend must
+    // match them exactly, both updating incrementally and refreshing.
+    setNnueBackend(NNUE_SCALAR);
+    std::vector<GameState> samples = samplePositions(net, plies, seed);
+    std::vector<int> expectedEval;
+    std::vector<uint64_t> expectedAcc;
+    double quantizationError = 0;
+    forEachChild(samples, [&](GameState &g) {
+        NnueAccumulator acc;
+        net.refresh(g.pos, acc);
+        Color stm = g.whiteTurn ? WHITE : BLACK;
+        expectedEval.push_back(net.evaluate(acc, stm));
+        expectedAcc.push_back(accumulatorHash(acc));
+        quantizationError += std::fabs(expectedEval.back() - net.evaluateFloat(g.pos, stm));
+    });
+    std::printf("%zu sampled positions, %zu checked, mean |quantized - float| %.2f cp\n", samples.size(),
+                expectedEval.size(), quantizationError / expectedEval.size());
+
+    uint64_t mismatches = 0;
+    for (NnueBackend b : backends) {
+        setNnueBackend(b);
+        for (GameState &g : samples) setNnue(g, &net);
+        size_t index = 0;
+        uint64_t failed = 0;
+        forEachChild(samples, [&](GameState &g) {
+            if (evaluate(g) != expectedEval[index] || evaluateFull(g) != expectedEval[index]
+                || accumulatorHash(g.nnueStack.back()) != expectedAcc[index]) {
+                if (++failed <= 5)
+                    std::printf("%s mismatch: %s  incremental %d  full %d  scalar %d\n", nnueBackendName(b),
+                                toFen(g).c_str(), evaluate(g), evaluateFull(g), expectedEval[index]);
+            }
+            ++index;
+        });
+        std::printf("%-7s %llu mismatches against scalar\n", nnueBackendName(b), (unsigned long long)failed);
+        mismatches += failed;
+    }
+
+    int64_t sum = 0;
+    for (NnueBackend b : backends) {
+        setNnueBackend(b);
+        for (GameState &g : samples) setNnue(g, &net);
+
+        auto t0 = Clock::now();
+        for (int r = 0; r < repeat * 20; ++r)
+            for (const GameState &g : samples) sum += evaluate(g);
+        double evalOnly = double(samples.size()) * repeat * 20 / secondsSince(t0);
+
+        t0 = Clock::now();
+        for (int r = 0; r < repeat * 5; ++r)
+            for (const GameState &g : samples) sum += evaluateFull(g);
+        double refreshed = double(samples.size()) * repeat * 5 / secondsSince(t0);
+
+        uint64_t count = 0;
+        t0 = Clock::now();
+        for (int r = 0; r < repeat; ++r)
+            forEachChild(samples, [&](GameState &g) {
+                sum += evaluate(g);
+                ++count;
+            });
+        double withMove = count / secondsSince(t0);
+
+        std::printf("%-7s eval %8.2f M/s  refresh+eval %7.2f M/s  make/eval/undo %7.2f M/s\n",
+                    nnueBackendName(b), evalOnly / 1e6, refreshed / 1e6, withMove / 1e6);
+    }
+    setNnueBackend(best);
+
+    auto t0 = Clock::now();
+    for (const GameState &g : samples) sum += int64_t(net.evaluateFloat(g.pos, g.whiteTurn ? WHITE : BLACK));
+    std::printf("float   eval %8.2f M/s (reference)\n", samples.size() / secondsSince(t0) / 1e6);
+    std::printf("checksum %lld\n", (long long)sum);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#include "perft.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static double nps(uint64_t nodes, double secs) {
+    return secs > 0 ? nodes / secs : 0.0;
+}
+
+static void usage() {
+    std::printf("usage: perft [--fen FEN] [--depth N] [--divide] [--hash MB [--large-pages]]\n"
+                "       perft --suite [--epd FILE] [--max-nodes N] [--hash MB [--large-pages]]\n");
+}
+
+// A table of size zero means plain perft.
+static TranspositionTable tt;
+static TTStats ttStats;
+static bool hashed = false;
+
+static uint64_t count(GameState &g, int depth) {
+    return hashed ? perftHashed(g, depth, tt, &ttStats) : perft(g, depth);
+}
+
+static void printHashStats() {
+    if (!hashed) return;
+    std::printf("hash %zu MB%s  probes %llu  hit rate %.1f%%  hashfull %d\n", tt.sizeMb(),
+                tt.usingLargePages() ? " (large pages)" : "", (unsigned long long)ttStats.probes,
+                100.0 * ttStats.hitRate(), tt.hashfull());
+}
+
+static int runSingle(const std::string &fen, int depth, bool divide) {
+    GameState g;
+    if (!loadFen(g, fen)) {
+        std::fprintf(stderr, "invalid FEN: %s\n", fen.c_str());
+        return 2;
+    }
+    std::printf("%s\n", fen.c_str());
+    for (int d = 1; d <= depth; ++d) {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t nodes = count(g, d);
+        double secs = secondsSince(t0);
+        std::printf("depth %2d  nodes %14llu  time %9.3fs  nps %12.0f\n",
+                    d, (unsigned long long)nodes, secs, nps(nodes, secs));
+    }
+    printHashStats();
+    if (divide) {
+        uint64_t total = 0;
+        auto split = perftDivide(g, depth);
+        for (auto &entry : split) {
+            std::printf("%s: %llu\n", moveToString(entry.first).c_str(), (unsigned long long)entry.second);
+            total += entry.second;
+        }
+        std::printf("moves %zu  nodes %llu\n", split.size(), (unsigned long long)total);
+    }
+    return 0;
+}
+
+// failures starts at the count of lines that did not parse.
+static int runSuite(const std::vector<PerftCase> &suite, uint64_t maxNodes, int failures = 0) {
+    uint64_t totalNodes = 0;
+    double totalSecs = 0;
+    for (const PerftCase &c : suite) {
+        GameState g;
+        if (!loadFen(g, c.fen)) {
+            std::printf("%-12s invalid FEN\n", c.name.c_str());
+            ++failures;
+            continue;
+        }
+        if (hashed) {
+            tt.clear();
+            ttStats = TTStats();
+        }
+        for (size_t d = 1; d <= c.nodes.size(); ++d) {
+            uint64_t expected = c.nodes[d - 1];
+            if (expected == 0) continue;
+            if (expected > maxNodes) break;
+            auto t0 = std::chrono::steady_clock::now();
+            uint64_t nodes = count(g, (int)d);
+            double secs = secondsSince(t0);
+            totalNodes += nodes;
+            totalSecs += secs;
+            bool ok = nodes == expected;
+            if (!ok) ++failures;
+            std::printf("%-12s depth %zu  nodes %12llu  expected %12llu  %s  nps %12.0f\n",
+                        c.name.c_str(), d, (unsigned long long)nodes, (unsigned long long)expected,
+                        ok ? "ok  " : "FAIL", nps(nodes, secs));
+        }
+    }
+    std::printf("total nodes %llu  time %.3fs  nps %.0f  failures %d\n",
+                (unsigned long long)totalNodes, totalSecs, nps(totalNodes, totalSecs), failures);
+    printHashStats();
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    std::string fen = START_FEN;
+    std::string epd;
+    int depth = 5;
+    bool divide = false;
+    bool suite = false;
+    uint64_t maxNodes = 5000000;
+    size_t hashMb = 0;
+    bool largePages = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) fen = argv[++i];
+        else if (arg == "--depth" && hasValue) depth = std::atoi(argv[++i]);
+        else if (arg == "--divide") divide = true;
+        else if (arg == "--suite") suite = true;
+        else if (arg == "--epd" && hasValue) { epd = argv[++i]; suite = true; }
+        else if (arg == "--max-nodes" && hasValue) maxNodes = std::strtoull(argv[++i], NULL, 10);
+        else if (arg == "--hash" && hasValue) hashMb = std::strtoull(argv[++i], NULL, 10);
+        else if (arg == "--large-pages") largePages = true;
+        else { usage(); return 2; }
+    }
+
+    if (hashMb) {
+        if (!tt.resize(hashMb, largePages)) {
+            std::fprintf(stderr, "cannot allocate %zu MB of hash\n", hashMb);
+            return 2;
+        }
+        hashed = true;
+    }
+
+    if (!suite) return runSingle(fen, depth, divide);
+
+    if (epd.empty()) return runSuite(perftSuite(), maxNodes);
+
+    std::ifstream in(epd);
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", epd.c_str());
+        return 2;
+    }
+    std::vector<PerftCase> cases;
+    std::string line;
+    int lineNumber = 0, badLines = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        PerftCase c;
+        if (parseEpdLine(line, c)) {
+            cases.push_back(c);
+        } else {
+            std::printf("%-12s invalid EPD line\n", ("line " + std::to_string(lineNumber)).c_str());
+            ++badLines;
+        }
+    }
+    return runSuite(cases, maxNodes, badLines);
+}
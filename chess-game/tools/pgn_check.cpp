@@ -0,0 +1,144 @@
+#include "pgn.h"
+#include "movegen.h"
+#include "session.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+static void usage() {
+    std::printf("usage: pgn-check FILE [--threads N] [--chunk KB] [--window N] [--results PATH] [--max-errors N]\n"
+                "       pgn-check --generate GAMES FILE [--seed N]\n");
+}
+
+// Peak resident set in KB, where the platform reports it.
+static long peakRssKb() {
+    long kb = 0;
+#ifdef __linux__
+    if (FILE *f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof line, f))
+            if (std::strncmp(line, "VmHWM:", 6) == 0) kb = std::atol(line + 6);
+        std::fclose(f);
+    }
+#endif
+    return kb;
+}
+
+// Random games in export format, with comments, NAGs and variations
+// sprinkled in so the reader has to skip them.
+static bool generate(const char *path, long games, uint64_t seed) {
+    FILE *out = std::fopen(path, "wb");
+    if (!out) return false;
+    std::mt19937_64 random(seed);
+    std::string text;
+    for (long n = 1; n <= games; ++n) {
+        GameState g;
+        initBoard(g);
+        std::string moves;
+        int limit = 20 + int(random() % 200);
+        GameStatus status = GAME_ONGOING;
+        for (int ply = 0; ply < limit; ++ply) {
+            MoveList list;
+            if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list)) break;
+            Move m = list.moves[random() % list.count];
+            if (g.whiteTurn) moves += std::to_string(ply / 2 + 1) + ". ";
+            moves += moveToSan(g, m) + ' ';
+            int extra = int(random() % 64);
+            if (extra == 0) moves += "{ a comment } ";
+            else if (extra == 1) moves += "$1 ";
+            else if (extra == 2 && list.count > 1) moves += "(" + moveToSan(g, list.moves[0]) + " { aside }) ";
+            makeMove(g, m);
+            if ((status = gameStatus(g)) != GAME_ONGOING) break;
+        }
+        const char *result = status == GAME_CHECKMATE ? (g.whiteTurn ? "0-1" : "1-0")
+                           : status == GAME_ONGOING ? "*" : "1/2-1/2";
+        text = "[Event \"Synthetic\"]\n[Site \"?\"]\n[Round \"" + std::to_string(n) + "\"]\n[White \"?\"]\n"
+               "[Black \"?\"]\n[Result \"" + result + "\"]\n\n";
+        // Wrapped at about 80 columns, like most exporters.
+        size_t column = 0;
+        for (size_t start = 0; start < moves.size();) {
+            size_t end = moves.find(' ', start);
+            std::string word = moves.substr(start, end - start);
+            if (column && column + word.size() >= 80) {
+                text += '\n';
+                column = 0;
+            }
+            text += (column ? " " : "") + word;
+            column += word.size() + 1;
+            start = end + 1;
+        }
+        text += std::string(column ? " " : "") + result + "\n\n";
+        std::fwrite(text.data(), 1, text.size(), out);
+    }
+    return std::fclose(out) == 0;
+}
+
+int main(int argc, char **argv) {
+    std::string path, resultsPath;
+    PgnOptions options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    long maxErrors = 20, generateGames = 0;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--chunk" && hasValue) options.chunkBytes = size_t(std::max(4, std::atoi(argv[++i]))) * 1024;
+        else if (arg == "--window" && hasValue) options.window = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--results" && hasValue) resultsPath = argv[++i];
+        else if (arg == "--max-errors" && hasValue) maxErrors = std::atol(argv[++i]);
+        else if (arg == "--generate" && hasValue) generateGames = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else if (arg[0] != '-' && path.empty()) path = arg;
+        else { usage(); return 2; }
+    }
+    if (path.empty()) {
+        usage();
+        return 2;
+    }
+
+    if (generateGames) {
+        if (!generate(path.c_str(), generateGames, seed)) {
+            std::fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+        std::printf("wrote %ld games to %s\n", generateGames, path.c_str());
+        return 0;
+    }
+
+    FILE *results = NULL;
+    if (!resultsPath.empty() && !(results = std::fopen(resultsPath.c_str(), "w"))) {
+        std::fprintf(stderr, "cannot write %s\n", resultsPath.c_str());
+        return 1;
+    }
+    long reported = 0;
+    PgnStats stats;
+    bool opened = checkPgnFile(path, options, [&](const std::vector<PgnGame> &games) {
+        for (const PgnGame &game : games) {
+            if (results)
+                std::fprintf(results, "%llu %llu %d %s %s\n", (unsigned long long)game.index,
+                             (unsigned long long)game.offset, game.plies, game.result.empty() ? "-" : game.result.c_str(),
+                             game.error.empty() ? "ok" : game.error.c_str());
+            if (!game.error.empty() && reported++ < maxErrors)
+                std::printf("game %llu at byte %llu: %s\n", (unsigned long long)game.index,
+                            (unsigned long long)game.offset, game.error.c_str());
+        }
+    }, stats);
+    if (results) std::fclose(results);
+    if (!opened) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+
+    double seconds = std::max(stats.seconds, 1e-9);
+    std::printf("%llu games, %llu plies, %llu errors in %.2f s on %d threads\n", (unsigned long long)stats.games,
+                (unsigned long long)stats.plies, (unsigned long long)stats.errors, stats.seconds, options.threads);
+    std::printf("%.0f games/s, %.0f plies/s, %.1f MB/s, peak RSS %ld KB\n", stats.games / seconds,
+                stats.plies / seconds, stats.bytes / seconds / (1 << 20), peakRssKb());
+    return stats.errors ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+#include "search.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void usage() {
+    std::printf("usage: search-bench [--fen FEN] [--depth N] [--nodes N] [--movetime MS]\n"
+                "                    [--hash MB] [--threads N] [--syzygy PATH] [--verbose]\n"
+                "       search-bench --scaling [1,2,4,8,16,32] [--depth N] [--hash MB]\n"
+                "       search-bench --ordering [--depth N] [--hash MB]\n");
+}
+
+static std::string pvToString(const std::vector<Move> &pv) {
+    std::string s;
+    for (const Move &m : pv) {
+        if (!s.empty()) s += ' ';
+        s += moveToString(m);
+    }
+    return s;
+}
+
+static void printIteration(const SearchInfo &info) {
+    std::printf("  depth %2d  seldepth %2d  score %6d  nodes %10llu  time %7.3fs  pv %s\n",
+                info.depth, info.seldepth, info.score, (unsigned long long)info.nodes,
+                info.seconds, pvToString(info.pv).c_str());
+}
+
+struct BenchTotals {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t tbProbes = 0;
+    uint64_t tbHits = 0;
+    double tbSeconds = 0;
+};
+
+// Searches every position from a cleared table so time-to-depth is
+// comparable between runs.
+static bool runBench(const std::vector<std::string> &fens, const SearchLimits &limits,
+                     TranspositionTable &tt, bool perPosition, bool verbose, BenchTotals &totals) {
+    for (size_t i = 0; i < fens.size(); ++i) {
+        GameState g;
+        if (!loadFen(g, fens[i])) {
+            std::fprintf(stderr, "invalid FEN: %s\n", fens[i].c_str());
+            return false;
+        }
+        tt.clear();
+        if (verbose) std::printf("%s\n", fens[i].c_str());
+        SearchResult r = search(g, limits, tt, verbose ? IterationCallback(printIteration) : IterationCallback());
+        totals.nodes += r.info.nodes;
+        totals.seconds += r.info.seconds;
+        totals.ttProbes += r.info.ttProbes;
+        totals.ttHits += r.info.ttHits;
+        totals.tbProbes += r.info.tbProbes;
+        totals.tbHits += r.info.tbHits;
+        totals.tbSeconds += r.info.tbSeconds;
+        if (!perPosition) continue;
+        std::printf("%2zu  depth %2d  score %6d  nodes %10llu  time %7.3fs  nps %10.0f  best %s\n",
+                    i + 1, r.info.depth, r.info.score, (unsigned long long)r.info.nodes, r.info.seconds,
+                    r.info.seconds > 0 ? r.info.nodes / r.info.seconds : 0.0,
+                    r.hasMove ? moveToString(r.best).c_str() : "(none)");
+    }
+    return true;
+}
+
+// Nodes-to-depth with SEE, killers and history against MVV-LVA and the
+// transposition move alone, single-threaded so the counts are exact.
+static bool compareOrdering(const std::vector<std::string> &fens, SearchLimits limits, TranspositionTable &tt) {
+    limits.threads = 1;
+    std::printf("%zu positions to depth %d\n", fens.size(), limits.depth);
+    std::printf("%-4s %14s %9s %14s %9s %7s\n", "", "plain nodes", "time", "ordered nodes", "time", "ratio");
+    BenchTotals plainTotals, orderedTotals;
+    for (size_t i = 0; i < fens.size(); ++i) {
+        BenchTotals plain, ordered;
+        limits.orderingHeuristics = false;
+        if (!runBench({fens[i]}, limits, tt, false, false, plain)) return false;
+        limits.orderingHeuristics = true;
+        if (!runBench({fens[i]}, limits, tt, false, false, ordered)) return false;
+        std::printf("%-4zu %14llu %8.3fs %14llu %8.3fs %7.2f\n", i + 1, (unsigned long long)plain.nodes,
+                    plain.seconds, (unsigned long long)ordered.nodes, ordered.seconds,
+                    ordered.nodes ? double(plain.nodes) / ordered.nodes : 0.0);
+        plainTotals.nodes += plain.nodes;
+        plainTotals.seconds += plain.seconds;
+        orderedTotals.nodes += ordered.nodes;
+        orderedTotals.seconds += ordered.seconds;
+    }
+    std::printf("%-4s %14llu %8.3fs %14llu %8.3fs %7.2f\n", "all", (unsigned long long)plainTotals.nodes,
+                plainTotals.seconds, (unsigned long long)orderedTotals.nodes, orderedTotals.seconds,
+                orderedTotals.nodes ? double(plainTotals.nodes) / orderedTotals.nodes : 0.0);
+    return true;
+}
+
+static std::vector<int> parseThreadList(const std::string &text) {
+    std::vector<int> counts;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int n = std::atoi(item.c_str());
+        if (n > 0) counts.push_back(n);
+    }
+    return counts;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> fens;
+    std::vector<int> scaling;
+    SearchLimits limits;
+    size_t hashMb = 16;
+    bool verbose = false, ordering = false;
+    std::string syzygyPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--fen" && hasValue) fens.push_back(argv[++i]);
+        else if (arg == "--depth" && hasValue) limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--nodes" && hasValue) limits.nodes = std::strtoull(argv[++i], NULL, 10);
+        else if (arg == "--movetime" && hasValue) limits.movetimeMs = std::atoll(argv[++i]);
+        else if (arg == "--hash" && hasValue) hashMb = std::strtoull(argv[++i], NULL, 10);
+        else if (arg == "--threads" && hasValue) limits.threads = std::atoi(argv[++i]);
+        else if (arg == "--syzygy" && hasValue) syzygyPath = argv[++i];
+        else if (arg == "--verbose") verbose = true;
+        else if (arg == "--ordering") ordering = true;
+        else if (arg == "--scaling") {
+            scaling = {1, 2, 4, 8, 16, 32};
+            if (hasValue && argv[i + 1][0] != '-') scaling = parseThreadList(argv[++i]);
+        }
+        else { usage(); return 2; }
+    }
+    if (!limits.depth && !limits.nodes && !limits.movetimeMs) limits.depth = 10;
+    if (fens.empty()) fens = benchPositions();
+
+    TranspositionTable tt;
+    if (!tt.resize(hashMb)) {
+        std::fprintf(stderr, "cannot allocate %zu MB of hash\n", hashMb);
+        return 2;
+    }
+    Tablebases tablebases;
+    if (!syzygyPath.empty()) {
+        int count = tablebases.init(syzygyPath);
+        std::printf("%d tablebases, up to %d pieces\n", count, tablebases.maxPieces());
+        if (tablebases.tableCount()) limits.tablebases = &tablebases;
+    }
+
+    if (ordering) return compareOrdering(fens, limits, tt) ? 0 : 2;
+
+    if (scaling.empty()) {
+        BenchTotals totals;
+        if (!runBench(fens, limits, tt, true, verbose, totals)) return 2;
+        std::printf("total nodes %llu  time %.3fs  nps %.0f  tt hit rate %.1f%%\n",
+                    (unsigned long long)totals.nodes, totals.seconds,
+                    totals.seconds > 0 ? totals.nodes / totals.seconds : 0.0,
+                    totals.ttProbes ? 100.0 * totals.ttHits / totals.ttProbes : 0.0);
+        if (limits.tablebases)
+            std::printf("tb probes %llu  hits %llu  %.2f us/probe  files mapped %llu  evicted %llu\n",
+                        (unsigned long long)totals.tbProbes, (unsigned long long)totals.tbHits,
+                        totals.tbProbes ? totals.tbSeconds * 1e6 / totals.tbProbes : 0.0,
+                        (unsigned long long)tablebases.filesMapped(), (unsigned long long)tablebases.filesEvicted());
+        return 0;
+    }
+
+    // Speedup is time-to-depth relative to the first thread count listed.
+    std::printf("hardware threads %u, %zu positions to depth %d\n",
+                std::thread::hardware_concurrency(), fens.size(), limits.depth);
+    double baseline = 0;
+    for (int threads : scaling) {
+        limits.threads = threads;
+        BenchTotals totals;
+        if (!runBench(fens, limits, tt, false, false, totals)) return 2;
+        if (baseline == 0) baseline = totals.seconds;
+        std::printf("threads %2d  time %8.3fs  nodes %12llu  nps %11.0f  speedup %5.2f\n", threads,
+                    totals.seconds, (unsigned long long)totals.nodes,
+                    totals.seconds > 0 ? totals.nodes / totals.seconds : 0.0,
+                    totals.seconds > 0 ? baseline / totals.seconds : 0.0);
+    }
+    return 0;
+}
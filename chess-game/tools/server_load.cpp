@@ -0,0 +1,256 @@
+#include "analysis.h"
+#include "movegen.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage() {
+    std::printf("usage: server-load [--socket PATH | --port N] [--connections N] [--requests N] [--window N]\n"
+                "                   [--mix LEGAL,STATUS,BESTMOVE] [--depth N] [--seed N]\n");
+}
+
+static int connectTo(const std::string &socketPath, int port) {
+    int fd;
+    if (port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(uint16_t(port));
+        if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof addr) < 0) {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    } else {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socketPath.c_str(), sizeof addr.sun_path - 1);
+        if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof addr) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        done += size_t(n);
+    }
+    return true;
+}
+
+// Positions from random games off the bench positions, so the server sees
+// openings, middlegames and endgames rather than one FEN over and over.
+static std::vector<std::string> samplePositions(uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<std::string> fens;
+    for (const std::string &fen : benchPositions()) {
+        GameState g;
+        loadFen(g, fen);
+        for (int ply = 0; ply < 40; ++ply) {
+            MoveList list;
+            if (!generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list)) break;
+            makeMove(g, list.moves[random() % list.count]);
+            fens.push_back(toFen(g));
+        }
+    }
+    return fens;
+}
+
+struct Sent {
+    Clock::time_point at;
+    AnalysisOp op;
+};
+
+struct ClientResult {
+    std::vector<uint32_t> latencies[ANALYSIS_STATS];    // microseconds, client side
+    int errors = 0;
+    bool failed = false;
+};
+
+static void runClient(const std::string &socketPath, int port, int requests, int window, const int mix[3],
+                      int depth, const std::vector<std::string> &fens, uint64_t seed, ClientResult &result) {
+    int fd = connectTo(socketPath, port);
+    if (fd < 0) {
+        result.failed = true;
+        return;
+    }
+    std::mt19937_64 random(seed);
+    std::vector<Sent> sent(requests);
+    std::string input, batch;
+    int issued = 0, answered = 0;
+    char buffer[65536];
+    while (answered < requests) {
+        batch.clear();
+        for (; issued < requests && issued - answered < window; ++issued) {
+            int pick = int(random() % (mix[0] + mix[1] + mix[2]));
+            AnalysisOp op = pick < mix[0] ? ANALYSIS_LEGAL : pick < mix[0] + mix[1] ? ANALYSIS_STATUS : ANALYSIS_BESTMOVE;
+            batch += std::to_string(issued) + ' ' + analysisOpName(op);
+            if (op == ANALYSIS_BESTMOVE) batch += " depth " + std::to_string(depth);
+            batch += ' ' + fens[random() % fens.size()] + '\n';
+            sent[issued] = Sent{Clock::now(), op};
+        }
+        if (!batch.empty() && !sendAll(fd, batch)) break;
+
+        ssize_t n = recv(fd, buffer, sizeof buffer, 0);
+        if (n <= 0) break;
+        input.append(buffer, size_t(n));
+        size_t start = 0, end;
+        while ((end = input.find('\n', start)) != std::string::npos) {
+            const char *line = input.c_str() + start;
+            long id = std::strncmp(line, "{\"id\":", 6) == 0 ? std::strtol(line + 6, NULL, 10) : -1;
+            if (id >= 0 && id < requests) {
+                const Sent &s = sent[id];
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s.at).count();
+                result.latencies[s.op].push_back(uint32_t(us));
+            }
+            if (id < 0 || id >= requests || input.find("\"error\"", start) < end) ++result.errors;
+            ++answered;
+            start = end + 1;
+        }
+        input.erase(0, start);
+    }
+    result.failed = answered < requests;
+    close(fd);
+}
+
+// Positions no game can reach must be answered with an error, and the
+// server must still answer the next request on the connection. Returns the
+// number of answers that were not as expected.
+static int checkRejects(const std::string &socketPath, int port) {
+    static const char *const LINES[] = {
+        "1 bestmove depth 4 4k3/8/8/8/8/8/8/4R1K1 w - - 0 1",    // black's king can be taken
+        "2 legal P3k3/8/8/8/8/8/8/6K1 w - - 0 1",                // pawn on the back rank
+        "3 status 4k3/8/8/8/8/8/8/6Kp b - - 0 1",
+        "4 bestmove depth 4 4k3/8/8/8/8/8/3PK3/8 w - e3 0 1",    // en passant square no pawn passed
+        "5 legal startpos",
+    };
+    const int count = int(sizeof LINES / sizeof LINES[0]);
+    int fd = connectTo(socketPath, port);
+    if (fd < 0) return count;
+    std::string batch;
+    for (const char *line : LINES) batch += std::string(line) + '\n';
+    int wrong = count;
+    if (sendAll(fd, batch)) {
+        wrong = 0;
+        std::string line;
+        char c;
+        for (int answered = 0; answered < count;) {
+            if (recv(fd, &c, 1, 0) != 1) {
+                wrong += count - answered;
+                break;
+            }
+            if (c != '\n') {
+                line += c;
+                continue;
+            }
+            long id = std::strncmp(line.c_str(), "{\"id\":", 6) == 0 ? std::strtol(line.c_str() + 6, NULL, 10) : -1;
+            bool error = line.find("\"error\"") != std::string::npos;
+            if (id < 1 || id > count || error != (id < count)) ++wrong;
+            ++answered;
+            line.clear();
+        }
+    }
+    close(fd);
+    return wrong;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, size_t(sorted.size() * p))];
+}
+
+int main(int argc, char **argv) {
+    std::string socketPath = "/tmp/chess-analysis.sock";
+    int port = 0, connections = 4, requests = 2000, window = 16, depth = 6;
+    int mix[3] = {70, 25, 5};
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if (arg == "--port" && hasValue) port = std::atoi(argv[++i]);
+        else if (arg == "--connections" && hasValue) connections = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--requests" && hasValue) requests = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--window" && hasValue) window = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--depth" && hasValue) depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else if (arg == "--mix" && hasValue) {
+            if (std::sscanf(argv[++i], "%d,%d,%d", &mix[0], &mix[1], &mix[2]) != 3 || mix[0] < 0 || mix[1] < 0
+                || mix[2] < 0 || mix[0] + mix[1] + mix[2] == 0) {
+                usage();
+                return 2;
+            }
+        } else { usage(); return 2; }
+    }
+
+    std::vector<std::string> fens = samplePositions(seed);
+    std::vector<ClientResult> results(connections);
+    std::vector<std::thread> clients;
+    auto t0 = Clock::now();
+    for (int c = 0; c < connections; ++c)
+        clients.emplace_back(runClient, socketPath, port, requests, window, mix, depth, std::cref(fens), seed + c,
+                             std::ref(results[c]));
+    for (std::thread &t : clients) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    int errors = 0, failed = 0;
+    size_t total = 0;
+    std::vector<uint32_t> merged[ANALYSIS_STATS];
+    for (ClientResult &r : results) {
+        errors += r.errors;
+        failed += r.failed;
+        for (int op = 0; op < ANALYSIS_STATS; ++op) {
+            merged[op].insert(merged[op].end(), r.latencies[op].begin(), r.latencies[op].end());
+            total += r.latencies[op].size();
+        }
+    }
+    std::printf("%d connections, window %d: %zu answers in %.2f s, %.0f requests/s, %d errors, %d failed connections\n",
+                connections, window, total, seconds, total / seconds, errors, failed);
+    for (int op = 0; op < ANALYSIS_STATS; ++op) {
+        std::vector<uint32_t> &l = merged[op];
+        if (l.empty()) continue;
+        std::sort(l.begin(), l.end());
+        std::printf("%-9s %7zu  p50 %7u us  p99 %7u us  p99.9 %7u us  max %8u us\n", analysisOpName(AnalysisOp(op)),
+                    l.size(), percentile(l, 0.5), percentile(l, 0.99), percentile(l, 0.999), l.back());
+    }
+
+    int rejectErrors = checkRejects(socketPath, port);
+    std::printf("unreachable positions: %s\n", rejectErrors ? "NOT REJECTED" : "rejected");
+
+    // The server's own view: queue depth and latencies from receipt to answer.
+    int fd = connectTo(socketPath, port);
+    if (fd >= 0 && sendAll(fd, "0 stats\n")) {
+        std::string line;
+        char c;
+        while (recv(fd, &c, 1, 0) == 1 && c != '\n') line += c;
+        std::printf("server %s\n", line.c_str());
+    }
+    if (fd >= 0) close(fd);
+    return failed || errors || rejectErrors ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+#include "service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *FEN = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
+
+static void usage() {
+    std::printf("usage: service-bench [--runs N] [--think-ms MS] [--threads N]\n");
+}
+
+static double microsSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+static void report(const char *name, std::vector<double> &samples, int failures) {
+    if (samples.empty()) {
+        std::printf("%-22s no samples  failures %d\n", name, failures);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    std::printf("%-22s min %9.1fus  median %9.1fus  p99 %9.1fus  max %9.1fus  failures %d\n", name,
+                samples[0], samples[n / 2], samples[std::min(n - 1, n * 99 / 100)], samples[n - 1], failures);
+}
+
+// Waits for the completion of id, discarding any older ones still queued.
+static bool awaitId(SearchService &service, uint64_t id, SearchCompletion &out) {
+    while (service.waitCompletion(out, 10000))
+        if (out.id == id) return true;
+    return false;
+}
+
+int main(int argc, char **argv) {
+    int runs = 200;
+    int thinkMs = 20;
+    int threads = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--runs" && hasValue) runs = std::atoi(argv[++i]);
+        else if (arg == "--think-ms" && hasValue) thinkMs = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) threads = std::atoi(argv[++i]);
+        else { usage(); return 2; }
+    }
+
+    GameState g;
+    loadFen(g, FEN);
+    SearchService service;
+    SearchLimits infinite;
+    infinite.threads = threads;
+    SearchLimits shallow = infinite;
+    shallow.depth = 1;
+    SearchCompletion c;
+
+    // start() of a depth-1 search until its completion can be polled.
+    std::vector<double> roundTrip;
+    int roundTripFailures = 0;
+    for (int i = 0; i < runs; ++i) {
+        auto t0 = Clock::now();
+        uint64_t id = service.start(g, shallow);
+        if (awaitId(service, id, c) && !c.cancelled && c.result.hasMove) roundTrip.push_back(microsSince(t0));
+        else ++roundTripFailures;
+    }
+
+    // stop() of a running infinite search until its best move arrives.
+    std::vector<double> stopLatency;
+    int stopFailures = 0;
+    for (int i = 0; i < runs; ++i) {
+        uint64_t id = service.start(g, infinite);
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+        auto t0 = Clock::now();
+        service.stop();
+        if (awaitId(service, id, c) && !c.cancelled && c.result.hasMove) stopLatency.push_back(microsSince(t0));
+        else ++stopFailures;
+    }
+
+    // cancel() until the worker is idle again.
+    std::vector<double> cancelLatency;
+    int cancelFailures = 0;
+    for (int i = 0; i < runs; ++i) {
+        uint64_t id = service.start(g, infinite);
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+        auto t0 = Clock::now();
+        service.cancel();
+        while (service.busy()) std::this_thread::yield();
+        double us = microsSince(t0);
+        if (awaitId(service, id, c) && c.cancelled) cancelLatency.push_back(us);
+        else ++cancelFailures;
+    }
+
+    // start() over a running search until the new request's result arrives.
+    std::vector<double> restart;
+    int restartFailures = 0;
+    for (int i = 0; i < runs; ++i) {
+        uint64_t old = service.start(g, infinite);
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+        auto t0 = Clock::now();
+        uint64_t id = service.start(g, shallow);
+        bool oldCancelled = awaitId(service, old, c) && c.cancelled;
+        if (oldCancelled && awaitId(service, id, c) && !c.cancelled) restart.push_back(microsSince(t0));
+        else ++restartFailures;
+    }
+
+    // ponderHit() with movetime thinkMs: how far past thinkMs the answer comes.
+    std::vector<double> ponderOvershoot;
+    int ponderFailures = 0;
+    SearchLimits timed = infinite;
+    timed.movetimeMs = thinkMs;
+    for (int i = 0; i < runs; ++i) {
+        uint64_t id = service.start(g, timed, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(thinkMs));
+        auto t0 = Clock::now();
+        service.ponderHit();
+        if (awaitId(service, id, c) && !c.cancelled && c.result.hasMove)
+            ponderOvershoot.push_back(microsSince(t0) - thinkMs * 1000.0);
+        else ++ponderFailures;
+    }
+
+    std::printf("%d runs, %d ms think time, %d search thread%s\n", runs, thinkMs, threads, threads == 1 ? "" : "s");
+    report("depth-1 round trip", roundTrip, roundTripFailures);
+    report("stop -> result", stopLatency, stopFailures);
+    report("cancel -> idle", cancelLatency, cancelFailures);
+    report("restart -> result", restart, restartFailures);
+    report("ponderhit overshoot", ponderOvershoot, ponderFailures);
+    int failures = roundTripFailures + stopFailures + cancelFailures + restartFailures + ponderFailures;
+    return failures ? 1 : 0;
+}
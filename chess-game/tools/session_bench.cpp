@@ -0,0 +1,123 @@
+#include "session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage() {
+    std::printf("usage: session-bench [--games N,N,...] [--plies N] [--threads N] [--shards N] [--seed N]\n");
+}
+
+// Resident set size in bytes, or 0 where /proc is not available.
+static size_t residentBytes() {
+    std::ifstream in("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(in >> pages >> resident)) return 0;
+    return resident * 4096;
+}
+
+static double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, size_t(sorted.size() * p))];
+}
+
+// Opens games sessions and plays them in rounds, one random legal move per
+// ongoing session a round, so every move lands on a different session than
+// the one before as it would with many clients.
+static void run(int games, int plies, int threads, int shards, uint64_t seed) {
+    std::vector<std::vector<uint32_t>> latencies(threads);
+    for (auto &l : latencies) l.reserve(size_t(games) * plies / threads + plies);
+    size_t rssBefore = residentBytes();
+
+    SessionHost host(shards);
+    std::vector<SessionId> ids(games);
+    auto t0 = Clock::now();
+    for (SessionId &id : ids) id = host.open();
+    double openSeconds = secondsSince(t0);
+
+    t0 = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 random(seed + t);
+            std::vector<uint32_t> &samples = latencies[t];
+            MoveList list;
+            for (int ply = 0; ply < plies; ++ply) {
+                for (size_t i = t; i < ids.size(); i += threads) {
+                    if (!host.legalMoves(ids[i], list) || list.empty()) continue;
+                    Move m = list.moves[random() % list.count];
+                    auto start = Clock::now();
+                    PlayResult result = host.play(ids[i], m);
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+                    if (result == PLAY_OK) samples.push_back(uint32_t(elapsed.count()));
+                }
+            }
+        });
+    }
+    for (std::thread &w : workers) w.join();
+    double playSeconds = secondsSince(t0);
+
+    std::vector<uint32_t> all;
+    for (auto &l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    size_t memory = host.memoryUsage();
+    size_t rss = residentBytes();
+
+    int finished = 0;
+    for (SessionId id : ids) {
+        GameStatus status;
+        if (host.status(id, status) && status != GAME_ONGOING) ++finished;
+    }
+    std::printf("%7d games  %9zu moves  %5.2f s  %8.0f moves/s  open %6.0f ns/game  finished %d\n", games,
+                all.size(), playSeconds, all.size() / playSeconds, openSeconds * 1e9 / games, finished);
+    if (!all.empty())
+        std::printf("        play latency  p50 %6u ns  p90 %6u ns  p99 %6u ns  p99.9 %6u ns  max %8u ns\n",
+                    percentile(all, 0.5), percentile(all, 0.9), percentile(all, 0.99), percentile(all, 0.999),
+                    all.back());
+    std::printf("        memory  host %7.1f B/session", double(memory) / games);
+    if (rssBefore && rss > rssBefore) std::printf("  resident %7.1f B/session", double(rss - rssBefore) / games);
+    std::printf("  (CompactGame %zu B)\n", sizeof(CompactGame));
+
+    for (SessionId id : ids) host.close(id);
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> counts = {1000, 10000, 100000};
+    int plies = 40, threads = 1, shards = 64;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            counts.clear();
+            std::istringstream in(argv[++i]);
+            std::string n;
+            while (std::getline(in, n, ','))
+                if (std::atoi(n.c_str()) > 0) counts.push_back(std::atoi(n.c_str()));
+        } else if (arg == "--plies" && hasValue) plies = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--shards" && hasValue) shards = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], NULL, 10);
+        else { usage(); return 2; }
+    }
+    if (counts.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::printf("%d plies per game, %d threads, %d shards\n", plies, threads, shards);
+    for (int games : counts) run(games, plies, threads, shards, seed);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "rules.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct Sample {
+    int sq;
+    Bitboard occupied;
+};
+
+static uint64_t rngState = 0x2545F4914F6CDD1Dull;
+
+static uint64_t nextRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1Dull;
+}
+
+// The pre-bitboard way: probe every target with the geometry test from
+// isLegalMove and walk the path square by square with clearPath().
+static Bitboard clearPathQueenAttacks(const GameState &g, int sq) {
+    int sx = squareX(sq), sy = squareY(sq);
+    Bitboard b = 0;
+    for (int ty = 0; ty < 8; ++ty) {
+        for (int tx = 0; tx < 8; ++tx) {
+            int adx = abs(tx - sx), ady = abs(ty - sy);
+            bool aligned = (adx == ady && adx > 0) || (adx == 0 && ady > 0) || (ady == 0 && adx > 0);
+            if (aligned && clearPath(g, sx, sy, tx, ty)) b |= squareBB(makeSquare(tx, ty));
+        }
+    }
+    return b;
+}
+
+template <typename F>
+static void run(const char *name, const std::vector<Sample> &samples, int rounds, F attacks, Bitboard expected) {
+    Bitboard sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        for (const Sample &s : samples) sum ^= attacks(s) + r;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double lookups = double(rounds) * samples.size();
+    std::printf("%-10s %8.2f ns/lookup  %8.1f M lookups/s  %s\n", name, secs * 1e9 / lookups,
+                lookups / secs / 1e6, sum == expected ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 4096;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::vector<Sample> samples(count);
+    for (Sample &s : samples) {
+        s.sq = (int)(nextRandom() & 63);
+        s.occupied = (nextRandom() & nextRandom()) | squareBB(s.sq);
+    }
+
+    // The mailbox path needs a board per sample; build them once, outside the timing.
+    std::vector<GameState> boards(count);
+    for (int i = 0; i < count; ++i) {
+        for (int sq = 0; sq < 64; ++sq)
+            boards[i].board[squareY(sq)][squareX(sq)] = (samples[i].occupied & squareBB(sq)) ? 'P' : '.';
+    }
+
+    Bitboard expected = 0;
+    for (int r = 0; r < rounds; ++r)
+        for (int i = 0; i < count; ++i)
+            expected ^= clearPathQueenAttacks(boards[i], samples[i].sq) + r;
+
+    std::printf("%d positions x %d rounds, queen attack sets, pext %s\n", count, rounds,
+                cpuHasPext() ? "available" : "unavailable");
+
+    const Sample *base = samples.data();
+    run("clearPath", samples, rounds, [&](const Sample &s) {
+        return clearPathQueenAttacks(boards[&s - base], s.sq);
+    }, expected);
+    run("magic", samples, rounds, [](const Sample &s) {
+        return bishopAttacksMagic(s.sq, s.occupied) | rookAttacksMagic(s.sq, s.occupied);
+    }, expected);
+    if (cpuHasPext()) {
+        run("pext", samples, rounds, [](const Sample &s) {
+            return bishopAttacksPext(s.sq, s.occupied) | rookAttacksPext(s.sq, s.occupied);
+        }, expected);
+    }
+    std::string backend = sliderBackend() == SLIDERS_PEXT ? "dispatch (pext)" : "dispatch (magic)";
+    run(backend.c_str(), samples, rounds, [](const Sample &s) {
+        return queenAttacks(s.sq, s.occupied);
+    }, expected);
+    return 0;
+}
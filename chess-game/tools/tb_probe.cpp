@@ -0,0 +1,147 @@
+#include "tablebase.h"
+#include "movegen.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+
+static const char *DEFAULT_FEN = "8/8/8/4k3/8/8/8/R3K3 w - - 0 1";
+
+static void usage() {
+    std::printf("usage: tb-probe --path DIRS [--fen FEN] [--moves \"a1a7 ...\"] [--iterations N]\n"
+                "                [--max-open N] [--verify PLIES]\n");
+}
+
+static const char *resultName(TBResult r) {
+    switch (r) {
+        case TB_WIN: return "win";
+        case TB_CURSED_WIN: return "cursed win";
+        case TB_DRAW: return "draw";
+        case TB_BLESSED_LOSS: return "blessed loss";
+        default: return "loss";
+    }
+}
+
+static bool playMoves(GameState &g, const std::string &moves) {
+    std::istringstream in(moves);
+    std::string text;
+    while (in >> text) {
+        Move m;
+        if (!parseMove(g, text, m)) {
+            std::fprintf(stderr, "illegal move: %s\n", text.c_str());
+            return false;
+        }
+        makeMove(g, m);
+    }
+    return true;
+}
+
+static int sign(int v) { return (v > 0) - (v < 0); }
+
+// Walks random games from start and checks at every covered position that
+// the result agrees with the best result among the replies, and that DTZ
+// agrees in sign. Needs the tables for every capture that can follow.
+static int verify(Tablebases &tb, const GameState &start, int plies) {
+    std::mt19937_64 random(1);
+    GameState g = start;
+    int checked = 0, failures = 0;
+    for (int ply = 0; ply < plies; ++ply) {
+        MoveList moves;
+        generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, moves);
+        TBResult wdl;
+        int dtz;
+        if (moves.empty() || !tb.probeWdl(g, wdl) || !tb.probeDtz(g, dtz)) {
+            g = start;
+            continue;
+        }
+        int best = -2;
+        bool complete = true;
+        for (const Move &m : moves) {
+            makeMove(g, m);
+            TBResult child;
+            if (!tb.probeWdl(g, child)) complete = false;
+            else best = std::max(best, sign(-child));
+            undoMove(g);
+        }
+        if (complete) {
+            ++checked;
+            if (sign(wdl) != best || sign(dtz) != sign(wdl)) {
+                ++failures;
+                std::printf("mismatch: %s  wdl %d  dtz %d  best reply %d\n", toFen(g).c_str(), int(wdl), dtz, best);
+            }
+        }
+        makeMove(g, moves.moves[random() % moves.count]);
+    }
+    std::printf("verified %d positions, %d mismatches\n", checked, failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    std::string path, fen = DEFAULT_FEN, moves;
+    int iterations = 10000, maxOpen = TB_DEFAULT_OPEN_FILES, verifyPlies = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--path" && hasValue) path = argv[++i];
+        else if (arg == "--fen" && hasValue) fen = argv[++i];
+        else if (arg == "--moves" && hasValue) moves = argv[++i];
+        else if (arg == "--iterations" && hasValue) iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--max-open" && hasValue) maxOpen = std::atoi(argv[++i]);
+        else if (arg == "--verify" && hasValue) verifyPlies = std::atoi(argv[++i]);
+        else { usage(); return 2; }
+    }
+    if (path.empty()) {
+        usage();
+        return 2;
+    }
+
+    Tablebases tb;
+    int count = tb.init(path, maxOpen);
+    std::printf("%d tablebases, up to %d pieces\n", count, tb.maxPieces());
+    if (!count) return 1;
+    GameState g;
+    if (!loadFen(g, fen)) {
+        std::fprintf(stderr, "invalid FEN: %s\n", fen.c_str());
+        return 1;
+    }
+    if (!playMoves(g, moves)) return 1;
+    if (verifyPlies > 0) return verify(tb, g, verifyPlies);
+
+    TBResult wdl, outcome, rootResult;
+    int dtz, rootDtz;
+    Move best;
+    if (!tb.probeWdl(g, wdl) || !tb.probeDtz(g, dtz)) {
+        std::printf("%s: not in the tables\n", toFen(g).c_str());
+        return 1;
+    }
+    std::printf("%s\n  wdl %s  dtz %d", toFen(g).c_str(), resultName(wdl), dtz);
+    if (tb.probeOutcome(g, outcome)) std::printf("  with clock %d: %s", g.halfmoveClock, resultName(outcome));
+    if (tb.probeRoot(g, best, rootResult, rootDtz)) std::printf("  best %s", moveToString(best).c_str());
+    std::printf("\n");
+
+    MoveList list;
+    generateLegalMoves(g, g.whiteTurn ? WHITE : BLACK, list);
+    for (const Move &m : list) {
+        makeMove(g, m);
+        TBResult child;
+        int childDtz;
+        if (tb.probeWdl(g, child) && tb.probeDtz(g, childDtz))
+            std::printf("  %-6s %-12s dtz %d\n", moveToString(m).c_str(), resultName(TBResult(-child)), -childDtz);
+        else
+            std::printf("  %-6s not in the tables\n", moveToString(m).c_str());
+        undoMove(g);
+    }
+
+    // The first probe maps the files; these are the warm costs.
+    TBStats wdlStats, dtzStats;
+    for (int i = 0; i < iterations; ++i) tb.probeWdl(g, wdl, &wdlStats);
+    for (int i = 0; i < iterations; ++i) tb.probeDtz(g, dtz, &dtzStats);
+    std::printf("wdl %.3f us/probe  dtz %.3f us/probe  files open %d  mapped %llu  evicted %llu\n",
+                wdlStats.microsPerProbe(), dtzStats.microsPerProbe(), tb.openFiles(),
+                (unsigned long long)tb.filesMapped(), (unsigned long long)tb.filesEvicted());
+    return 0;
+}
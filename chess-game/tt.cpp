@@ -0,0 +1,143 @@
+#include "tt.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+inline uint64_t packData(uint64_t payload, int depth, Bound bound, unsigned generation) {
+    return payload << 16 | uint64_t(generation) << 10 | uint64_t(bound) << 8 | uint64_t(depth & 0xFF);
+}
+
+inline int dataDepth(uint64_t data) { return int(data & 0xFF); }
+inline Bound dataBound(uint64_t data) { return Bound((data >> 8) & 3); }
+inline unsigned dataGeneration(uint64_t data) { return unsigned(data >> 10) & 63; }
+
+void *allocateAligned(size_t bytes) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, 64);
+#else
+    return std::aligned_alloc(64, bytes);
+#endif
+}
+
+void freeAligned(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+void TranspositionTable::release() {
+    if (!buckets) return;
+#ifdef __linux__
+    if (mapped) munmap(buckets, allocatedBytes);
+    else freeAligned(buckets);
+#else
+    freeAligned(buckets);
+#endif
+    buckets = nullptr;
+    bucketCount = allocatedBytes = 0;
+    largePages = mapped = false;
+}
+
+bool TranspositionTable::resize(size_t mb, bool wantLargePages) {
+    release();
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= (mb << 20)) count *= 2;
+    size_t bytes = count * sizeof(Bucket);
+
+#ifdef __linux__
+    if (wantLargePages) {
+        void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            buckets = static_cast<Bucket *>(p);
+            mapped = largePages = true;
+        }
+    }
+#endif
+    if (!buckets) {
+        buckets = static_cast<Bucket *>(allocateAligned(bytes));
+        if (!buckets) return false;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        // Transparent huge pages are the next best thing when none are reserved.
+        if (wantLargePages) largePages = madvise(buckets, bytes, MADV_HUGEPAGE) == 0;
+#endif
+    }
+    bucketCount = count;
+    allocatedBytes = bytes;
+    clear();
+    return true;
+}
+
+void TranspositionTable::clear() {
+    if (buckets) std::memset(static_cast<void *>(buckets), 0, allocatedBytes);
+    generation.store(0, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData &out, TTStats *stats) {
+    if (stats) ++stats->probes;
+    Bucket &b = bucketFor(key);
+    for (Entry &e : b.entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key || !data) continue;
+        out.payload = data >> 16;
+        out.depth = dataDepth(data);
+        out.bound = dataBound(data);
+        if (stats) ++stats->hits;
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, uint64_t payload, int depth, Bound bound) {
+    Bucket &b = bucketFor(key);
+    // Reuse the entry already holding this key, otherwise evict the one with
+    // the least depth, counting each search it has survived as eight plies.
+    unsigned current = currentGeneration();
+    Entry *victim = &b.entries[0];
+    int victimWorth = 1 << 30;
+    for (Entry &e : b.entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.check.load(std::memory_order_relaxed) ^ data) == key || !data) {
+            victim = &e;
+            break;
+        }
+        int age = (current - dataGeneration(data)) & GENERATION_MASK;
+        int worth = dataDepth(data) - 8 * age;
+        if (worth < victimWorth) {
+            victimWorth = worth;
+            victim = &e;
+        }
+    }
+    uint64_t data = packData(payload & TT_PAYLOAD_MAX, depth, bound, current);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    if (!buckets) return 0;
+    size_t sample = bucketCount < 250 ? bucketCount : 250;
+    unsigned current = currentGeneration();
+    int used = 0;
+    for (size_t i = 0; i < sample; ++i)
+        for (const Entry &e : buckets[i].entries) {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            if (data && dataGeneration(data) == current) ++used;
+        }
+    return int(used * 1000 / (sample * 4));
+}
@@ -0,0 +1,78 @@
+#ifndef CHESS_TT_H
+#define CHESS_TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum Bound { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+// What a probe hands back. The 48-bit payload is the caller's: the search
+// packs move/score/eval into it, hashed perft stores a node count.
+struct TTData {
+    uint64_t payload = 0;
+    int depth = 0;
+    Bound bound = BOUND_NONE;
+};
+
+const uint64_t TT_PAYLOAD_MAX = (uint64_t(1) << 48) - 1;
+
+// Probe counters live with the caller (one per search thread) so that
+// threads sharing the table do not also share a counter cache line.
+struct TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+    double hitRate() const { return probes ? double(hits) / probes : 0.0; }
+};
+
+// Fixed-size table of 64-byte buckets, each holding four entries. Entries
+// are stored as (key ^ data, data) pairs with relaxed atomics and no locks:
+// a torn read from a concurrent writer fails the key check and is a miss.
+class TranspositionTable {
+public:
+    TranspositionTable() = default;
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    // Reallocates to the largest power-of-two bucket count that fits in mb
+    // and clears it. largePages asks Linux for huge pages and quietly falls
+    // back to normal ones.
+    bool resize(size_t mb, bool largePages = false);
+    void clear();
+    // Safe to call while other threads use the table, though entries from
+    // searches still running then age as if those had finished.
+    void newSearch() { generation.fetch_add(1, std::memory_order_relaxed); }
+
+    bool probe(uint64_t key, TTData &out, TTStats *stats = nullptr);
+    void store(uint64_t key, uint64_t payload, int depth, Bound bound);
+
+    size_t sizeMb() const { return bucketCount * sizeof(Bucket) >> 20; }
+    bool usingLargePages() const { return largePages; }
+    int hashfull() const;    // per mille of sampled entries written this search
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;    // key ^ data
+        std::atomic<uint64_t> data;     // payload << 16 | generation << 10 | bound << 8 | depth
+    };
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+
+    static const unsigned GENERATION_MASK = 63;
+
+    void release();
+    Bucket &bucketFor(uint64_t key) { return buckets[key & (bucketCount - 1)]; }
+    unsigned currentGeneration() const { return generation.load(std::memory_order_relaxed) & GENERATION_MASK; }
+
+    Bucket *buckets = nullptr;
+    size_t bucketCount = 0;
+    size_t allocatedBytes = 0;
+    bool largePages = false;
+    bool mapped = false;
+    std::atomic<unsigned> generation{0};    // masked with GENERATION_MASK when read
+};
+
+#endif
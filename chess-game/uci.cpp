@@ -0,0 +1,281 @@
+#include "book.h"
+#include "service.h"
+#include "tablebase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const int DEFAULT_HASH_MB = 32;
+const int DEFAULT_BENCH_DEPTH = 10;
+
+// Iteration info and bestmove come from the search worker, everything else
+// from the input loop; each line goes out whole.
+std::mutex outputMutex;
+
+void send(const std::string &line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+}
+
+std::string scoreToUci(int score) {
+    if (!isMateScore(score)) return "cp " + std::to_string(score);
+    int plies = SCORE_MATE - std::abs(score);
+    int moves = (plies + 1) / 2;
+    return "mate " + std::to_string(score > 0 ? moves : -moves);
+}
+
+std::string pvToString(const std::vector<Move> &pv) {
+    std::string s;
+    for (const Move &m : pv) {
+        if (!s.empty()) s += ' ';
+        s += moveToString(m);
+    }
+    return s;
+}
+
+void sendInfo(const SearchInfo &info) {
+    uint64_t ms = uint64_t(info.seconds * 1000);
+    uint64_t nps = info.seconds > 0 ? uint64_t(info.nodes / info.seconds) : 0;
+    send("info depth " + std::to_string(info.depth) + " seldepth " + std::to_string(info.seldepth)
+         + " score " + scoreToUci(info.score) + " nodes " + std::to_string(info.nodes)
+         + " nps " + std::to_string(nps) + " time " + std::to_string(ms)
+         + (info.tbHits ? " tbhits " + std::to_string(info.tbHits) : std::string()) + " pv " + pvToString(info.pv));
+}
+
+void sendBestMove(const SearchResult &result) {
+    if (!result.hasMove) {
+        send("bestmove 0000");
+        return;
+    }
+    std::string line = "bestmove " + moveToString(result.best);
+    if (result.info.pv.size() >= 2) line += " ponder " + moveToString(result.info.pv[1]);
+    send(line);
+}
+
+struct Engine {
+    SearchService service;
+    GameState position;
+    int threads = 1;
+    OpeningBook book;
+    std::mt19937_64 bookRandom{std::random_device{}()};
+    Tablebases tablebases;
+    NnueNetwork network;
+
+    Engine() : service([this] { onCompletion(); }) {
+        service.resizeHash(DEFAULT_HASH_MB);
+        loadFen(position, START_FEN);
+    }
+
+    void onCompletion() {
+        SearchCompletion done;
+        while (service.poll(done))
+            if (!done.cancelled) sendBestMove(done.result);
+    }
+
+    void setPosition(std::istringstream &in);
+    void go(std::istringstream &in);
+    void setOption(std::istringstream &in);
+};
+
+// position [startpos | fen <fen>] [moves <m1> <m2> ...]
+void Engine::setPosition(std::istringstream &in) {
+    std::string token, fen;
+    in >> token;
+    if (token == "startpos") {
+        fen = START_FEN;
+        in >> token;
+    } else if (token == "fen") {
+        while (in >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+    } else {
+        return;
+    }
+    GameState g;
+    if (!loadFen(g, fen)) {
+        send("info string invalid fen " + fen);
+        return;
+    }
+    while (in >> token) {
+        Move m;
+        if (!parseMove(g, token, m)) {
+            send("info string illegal move " + token);
+            break;
+        }
+        makeMove(g, m);
+    }
+    position = g;
+}
+
+// go [depth N] [nodes N] [movetime MS] [wtime MS btime MS winc MS binc MS movestogo N] [infinite] [ponder]
+void Engine::go(std::istringstream &in) {
+    SearchLimits limits;
+    limits.threads = threads;
+    if (tablebases.tableCount()) limits.tablebases = &tablebases;
+    if (network.isLoaded()) limits.nnue = &network;
+    int64_t time[2] = {0, 0}, inc[2] = {0, 0};
+    int movesToGo = 0;
+    bool infinite = false, ponder = false;
+    std::string token;
+    while (in >> token) {
+        if (token == "depth") in >> limits.depth;
+        else if (token == "nodes") in >> limits.nodes;
+        else if (token == "movetime") in >> limits.movetimeMs;
+        else if (token == "wtime") in >> time[WHITE];
+        else if (token == "btime") in >> time[BLACK];
+        else if (token == "winc") in >> inc[WHITE];
+        else if (token == "binc") in >> inc[BLACK];
+        else if (token == "movestogo") in >> movesToGo;
+        else if (token == "infinite") infinite = true;
+        else if (token == "ponder") ponder = true;
+    }
+
+    // A book move answers at once; searches the GUI must stop are left alone.
+    Move bookMove;
+    if (!ponder && !infinite && book.probe(position, bookMove, BOOK_WEIGHTED, bookRandom())) {
+        send("bestmove " + moveToString(bookMove));
+        return;
+    }
+
+    // With a clock, spend an even share of the remaining time plus most of
+    // the increment, keeping a margin for move overhead.
+    Color us = position.whiteTurn ? WHITE : BLACK;
+    if (!limits.movetimeMs && time[us] > 0) {
+        int64_t share = time[us] / (movesToGo > 0 ? movesToGo + 1 : 30) + inc[us] * 3 / 4;
+        limits.movetimeMs = std::max<int64_t>(1, std::min(share, time[us] - 50));
+    }
+    // "go infinite" must not answer before "stop"; the ponder hold gives
+    // exactly that with no limits set.
+    service.start(position, limits, ponder || infinite, sendInfo);
+}
+
+// setoption name <Hash|Threads> value <N>, setoption name <BookFile|SyzygyPath|EvalFile> value <path>
+void Engine::setOption(std::istringstream &in) {
+    std::string token, name, value;
+    in >> token;
+    while (in >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    std::getline(in >> std::ws, value);
+    if (name == "Hash") {
+        size_t mb = std::max(1, std::atoi(value.c_str()));
+        if (!service.resizeHash(mb)) send("info string cannot allocate " + value + " MB of hash");
+    } else if (name == "Threads") {
+        threads = std::max(1, std::min(MAX_THREADS, std::atoi(value.c_str())));
+    } else if (name == "BookFile") {
+        if (value.empty() || value == "<empty>") book.close();
+        else if (!book.open(value)) send("info string cannot open book " + value);
+    } else if (name == "SyzygyPath") {
+        // The tables are probed from the search threads, so reload only
+        // once the current search is gone.
+        service.cancel();
+        while (service.busy()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (value.empty() || value == "<empty>") tablebases.clear();
+        else send("info string found " + std::to_string(tablebases.init(value)) + " tablebases");
+    } else if (name == "EvalFile") {
+        // Same as the tables: the search threads read the weights.
+        service.cancel();
+        while (service.busy()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (value.empty() || value == "<empty>") network = NnueNetwork();
+        else if (network.load(value)) send(std::string("info string loaded network ") + value + " using "
+                                           + nnueBackendName(nnueBackend()));
+        else send("info string cannot load network " + value);
+    } else if (name == "Ponder") {
+        // Only tells the GUI it may send "go ponder"; nothing to configure.
+    } else {
+        send("info string unknown option " + name);
+    }
+}
+
+// Fixed-depth search over the bench positions on a cold table; the node
+// count doubles as a signature of the search's behaviour.
+void bench(int depth, int threads) {
+    TranspositionTable tt;
+    tt.resize(DEFAULT_HASH_MB);
+    SearchLimits limits;
+    limits.depth = depth;
+    limits.threads = threads;
+    uint64_t nodes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const std::string &fen : benchPositions()) {
+        GameState g;
+        loadFen(g, fen);
+        tt.clear();
+        nodes += search(g, limits, tt).info.nodes;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    send("Total time (ms) : " + std::to_string(uint64_t(secs * 1000)));
+    send("Nodes searched  : " + std::to_string(nodes));
+    send("Nodes/second    : " + std::to_string(secs > 0 ? uint64_t(nodes / secs) : 0));
+}
+
+int benchDepth(std::istringstream &in) {
+    int depth = 0;
+    in >> depth;
+    return depth > 0 ? depth : DEFAULT_BENCH_DEPTH;
+}
+
+}
+
+int main(int argc, char **argv) {
+    // "chess-uci bench [depth]" runs the bench and exits, for scripts.
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        std::istringstream in(argc > 2 ? argv[2] : "");
+        bench(benchDepth(in), 1);
+        return 0;
+    }
+
+    Engine engine;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        if (command == "uci") {
+            send("id name Chess Game");
+            send("id author Chess Game contributors");
+            send("option name Hash type spin default " + std::to_string(DEFAULT_HASH_MB) + " min 1 max 65536");
+            send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+            send("option name Ponder type check default false");
+            send("option name BookFile type string default <empty>");
+            send("option name SyzygyPath type string default <empty>");
+            send("option name EvalFile type string default <empty>");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            engine.service.cancel();
+            engine.service.clearHash();
+        } else if (command == "setoption") {
+            engine.setOption(in);
+        } else if (command == "position") {
+            engine.setPosition(in);
+        } else if (command == "go") {
+            engine.go(in);
+        } else if (command == "stop") {
+            engine.service.stop();
+        } else if (command == "ponderhit") {
+            engine.service.ponderHit();
+        } else if (command == "bench") {
+            bench(benchDepth(in), engine.threads);
+        } else if (command == "d") {
+            send(toFen(engine.position));
+        } else if (command == "quit") {
+            break;
+        } else if (!command.empty()) {
+            send("info string unknown command " + command);
+        }
+    }
+    engine.service.shutdown();
+    return 0;
+}
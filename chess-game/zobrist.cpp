@@ -0,0 +1,32 @@
+#include "zobrist.h"
+
+namespace {
+
+constexpr uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys buildKeys() {
+    ZobristKeys k{};
+    uint64_t state = 0x5A0B2157C0FFEE11ull;
+    for (int c = 0; c < 2; ++c)
+        for (int pt = 0; pt < 6; ++pt)
+            for (int sq = 0; sq < 64; ++sq)
+                k.pieces[c][pt][sq] = splitmix64(state);
+    // Each combination of rights gets the XOR of its single-right keys, so
+    // dropping one right is a single XOR of the two table entries.
+    uint64_t rights[4] = {splitmix64(state), splitmix64(state), splitmix64(state), splitmix64(state)};
+    for (int r = 0; r < 16; ++r)
+        for (int i = 0; i < 4; ++i)
+            if (r & (1 << i)) k.castling[r] ^= rights[i];
+    for (int f = 0; f < 8; ++f) k.epFile[f] = splitmix64(state);
+    k.blackToMove = splitmix64(state);
+    return k;
+}
+
+}
+
+extern constexpr ZobristKeys ZOBRIST = buildKeys();
@@ -0,0 +1,19 @@
+#ifndef CHESS_ZOBRIST_H
+#define CHESS_ZOBRIST_H
+
+#include "bitboard.h"
+
+struct ZobristKeys {
+    uint64_t pieces[2][6][64];
+    uint64_t castling[16];
+    uint64_t epFile[8];
+    uint64_t blackToMove;
+};
+
+extern const ZobristKeys ZOBRIST;
+
+inline uint64_t pieceKey(char p, int sq) {
+    return ZOBRIST.pieces[pieceColor(p)][pieceTypeOf(p)][sq];
+}
+
+#endif